@@ -1,13 +1,16 @@
 TEMPLATE = app
-CONFIG += console c++11
+CONFIG += console c++11 thread
 CONFIG -= app_bundle
 CONFIG -= qt
+#DEFINES += DD_NO_TIMERS  #compiles out the phase timers of timing_report (see phase_timer.h)
+#DEFINES += DD_TRACK_ALLOCATIONS  #counts the heap allocations per voltage and Gummel iteration (see alloc_tracking.h)
 #QMAKE_CXXFLAGS_RELEASE += -Ox  //Ox is "full optimization" for Msvc, seems no difference in speedfrom the default -O2
 
 SOURCES += \
     photogeneration.cpp \
     recombination.cpp \
     thomas_tridiag_solve.cpp \
+    block_tridiag_solve.cpp \
     poisson.cpp \
     continuity_n.cpp \
     continuity_p.cpp \
@@ -15,12 +18,27 @@ SOURCES += \
     Utilities.cpp \
     run_DD.cpp \
     main.cpp \
-    optimization.cpp
+    optimization.cpp \
+    newton.cpp \
+    anderson_mix.cpp \
+    thread_pool.cpp \
+    gaussian_process.cpp \
+    solution_cache.cpp \
+    multi_fidelity.cpp \
+    checkpoint.cpp \
+    batch.cpp \
+    snapshot_file.cpp \
+    output_policy.cpp \
+    phase_timer.cpp \
+    hw_counters.cpp \
+    alloc_tracking.cpp \
+    trace.cpp
 
 HEADERS += \
     photogeneration.h \
     recombination.h \
     thomas_tridiag_solve.h \
+    block_tridiag_solve.h \
     poisson.h \
     continuity_n.h \
     continuity_p.h \
@@ -28,4 +46,19 @@ HEADERS += \
     parameters.h \
     Utilities.h \
     run_DD.h \
-    optimization.h
+    optimization.h \
+    newton.h \
+    anderson_mix.h \
+    thread_pool.h \
+    gaussian_process.h \
+    solution_cache.h \
+    multi_fidelity.h \
+    checkpoint.h \
+    batch.h \
+    snapshot_file.h \
+    output_policy.h \
+    async_output.h \
+    phase_timer.h \
+    hw_counters.h \
+    alloc_tracking.h \
+    trace.h
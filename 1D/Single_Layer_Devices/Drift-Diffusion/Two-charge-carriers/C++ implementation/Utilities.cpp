@@ -5,26 +5,22 @@ Utilities::Utilities()
 {
 }
 
-std::vector<double> Utilities::linear_mix(const Parameters &params, const std::vector<double> &new_values,const std::vector<double> &old_values)
+void Utilities::linear_mix(const Parameters &params, const std::vector<double> &new_values, const std::vector<double> &old_values, std::vector<double> &result)
 {
-    static std::vector<double> result(params.num_cell+1);  //static so only allocate at 1st fnc call
-
     for (int i = 1; i < params.num_cell; i++) {  //note: all the changing values in vectors start from 1 (0th index is a BC)
         result[i] = new_values[i]*params.w + old_values[i]*(1.0 - params.w);
     }
-
-    return result;
 }
 
 
 void Utilities::write_details(const Parameters &params, double Va, const std::vector<double> &V, const std::vector<double> &p,  const std::vector<double> &n, const std::vector<double> &J_total, const std::vector<double>  &Un, const std::vector<double> &PhotogenRate, const std::vector<double> &R_Langevin)
 {
-        static std::ofstream VaData;
+        std::ofstream VaData;
         //Write charge densities, recombination rates, etc
         std::string filename = std::to_string(Va);
         filename += ".txt";  //add .txt extension
         VaData.open(filename); //this will need to have a string as file name
-        for (int i = 1; i <= params.num_cell; i++) {
+        for (int i = 1; i < params.num_cell; i++) {  //the interior points, as in the snapshot file (p, n, etc. have num_cell elements)
             VaData << std::setw(15) << std::setprecision(8) << params.dx*i;
             VaData << std::setw(15) << std::setprecision(8) << Vt*V[i];
             VaData << std::setw(15) << std::setprecision(8) << params.N*p[i];         //setprecision(8) sets that use 8 sigfigs
@@ -42,5 +38,25 @@ void Utilities::write_details(const Parameters &params, double Va, const std::ve
 void Utilities::write_JV(const Parameters &params, std::ofstream &JV, double iter, double Va, const double J_value)
 {
     if (JV.is_open())
-        JV << Va << " " << J_value << "\n";
+        JV << Va << " " << J_value << " " << iter << "\n";
+}
+
+void Utilities::write_convergence_header(std::ofstream &file)
+{
+    if (file.is_open())
+        file << "#Va iterations error w tolerance w_reductions time"
+             << (Alloc_tracking::compiled() ? " allocations allocated_bytes max_iteration_allocations max_iteration_bytes\n" : "\n");
+}
+
+void Utilities::write_convergence(std::ofstream &file, const Convergence_record &record)
+{
+    if (file.is_open()) {
+        file << record.Va << " " << record.iterations << " " << record.error << " " << record.w << " " << record.tolerance
+             << " " << record.w_reductions << " " << record.time;
+        if (Alloc_tracking::compiled()) {
+            file << " " << record.allocations.allocations << " " << record.allocations.bytes
+                 << " " << record.max_iteration_allocations.allocations << " " << record.max_iteration_allocations.bytes;
+        }
+        file << "\n";
+    }
 }
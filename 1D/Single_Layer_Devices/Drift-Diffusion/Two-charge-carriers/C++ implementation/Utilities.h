@@ -3,18 +3,32 @@
 
 #include <vector>
 #include "parameters.h"
+#include "alloc_tracking.h"
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 
+//!How the iterations at one voltage converged (a line of the convergence file, written next to the JV curve)
+struct Convergence_record
+{
+    double Va;
+    int iterations;
+    double error;          //error_np of the last iteration
+    double w, tolerance;   //mixing factor and tolerance at the end (after any reductions)
+    int w_reductions;      //# of times w was reduced and the tolerance relaxed because the iterations didn't converge
+    double time;           //wall time in s
+    Alloc_counts allocations;            //heap allocations of the solve (only counted with DD_TRACK_ALLOCATIONS, see Alloc_tracking)
+    Alloc_counts max_iteration_allocations;   //most allocations of a Gummel iteration after the 1st (the steady state)
+};
+
 class Utilities
 {
 public:
     Utilities();
 
     //!Applies linear mixing (result = w*new_value + (1-w)*old_value) where w is the mixing factor.
-    //! The mixing factor is in the \param params object.
-    std::vector<double> linear_mix(const Parameters &params,const std::vector<double> &new_values,const std::vector<double> &old_values);
+    //! The mixing factor is in the \param params object. The mixed values are written into \param result (the BC entries are not changed).
+    void linear_mix(const Parameters &params, const std::vector<double> &new_values, const std::vector<double> &old_values, std::vector<double> &result);
 
     //!This writes to output files the details of voltage \param V, carrier densities \param p and \param n, current \param J_total, net electron generation rate \param Un, photogeneration rate and Langevin recombination rate.
     //! The files are named according to the applied voltage \param Va of this data.
@@ -24,6 +38,10 @@ public:
     //! and the number of iterations \param iter required to converge at that voltage.
     void write_JV(const Parameters &params, std::ofstream &JV, double iter, double Va, const double J_value);
 
+    //!Writes the column names of the convergence file \param file, then each write_convergence writes the \param record of one voltage
+    void write_convergence_header(std::ofstream &file);
+    void write_convergence(std::ofstream &file, const Convergence_record &record);
+
 };
 
 #endif // UTILITIES_H
@@ -0,0 +1,63 @@
+#include "alloc_tracking.h"
+
+#ifdef DD_TRACK_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace {
+    //plain thread locals, so they are constant initialized and can be used by operator new at any time
+    thread_local long long thread_allocations = 0;
+    thread_local long long thread_bytes = 0;
+}
+
+void *operator new(std::size_t size)
+{
+    thread_allocations++;
+    thread_bytes += size;
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+void *operator new[](std::size_t size) {return operator new(size);}
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    thread_allocations++;
+    thread_bytes += size;
+    return std::malloc(size ? size : 1);
+}
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {return operator new(size, tag);}
+void operator delete(void *ptr) noexcept {std::free(ptr);}
+void operator delete[](void *ptr) noexcept {std::free(ptr);}
+void operator delete(void *ptr, std::size_t) noexcept {std::free(ptr);}
+void operator delete[](void *ptr, std::size_t) noexcept {std::free(ptr);}
+void operator delete(void *ptr, const std::nothrow_t&) noexcept {std::free(ptr);}
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept {std::free(ptr);}
+#endif
+
+
+bool Alloc_tracking::compiled()
+{
+#ifdef DD_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+Alloc_counts Alloc_tracking::counts()
+{
+#ifdef DD_TRACK_ALLOCATIONS
+    return {thread_allocations, thread_bytes};
+#else
+    return {0, 0};
+#endif
+}
+
+
+Alloc_counts Alloc_tracking::since(const Alloc_counts &start)
+{
+    const Alloc_counts now = counts();
+    return {now.allocations - start.allocations, now.bytes - start.bytes};
+}
@@ -0,0 +1,28 @@
+#ifndef ALLOC_TRACKING_H
+#define ALLOC_TRACKING_H
+
+//!Heap allocations (calls of operator new) and the bytes requested
+struct Alloc_counts
+{
+    long long allocations;
+    long long bytes;
+};
+
+//!Counts the heap allocations of each thread, to see how much the solver allocates per voltage and per Gummel iteration.
+//! Only compiled in if DD_TRACK_ALLOCATIONS is defined (see the .pro file): then alloc_tracking.cpp replaces the global
+//! operator new/delete with versions which count the allocations of the calling thread, which costs a thread local
+//! increment per allocation. Otherwise nothing is replaced and the counts are always 0.
+class Alloc_tracking
+{
+public:
+    //!True if built with DD_TRACK_ALLOCATIONS
+    static bool compiled();
+
+    //!The allocations of the calling thread so far (since the thread was started)
+    static Alloc_counts counts();
+
+    //!The allocations of the calling thread since \param start (an earlier counts())
+    static Alloc_counts since(const Alloc_counts &start);
+};
+
+#endif // ALLOC_TRACKING_H
@@ -0,0 +1,239 @@
+#include "batch.h"
+
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <mutex>
+#include <memory>
+
+#include "thread_pool.h"
+
+namespace {
+    //the output is little endian. Each value is written byte by byte, so this also works on a big endian machine
+    template<typename T> void write_le(std::ofstream &file, T value)
+    {
+        uint64_t bits = 0;
+        static_assert(sizeof(T) <= sizeof(bits), "value too large");
+        memcpy(&bits, &value, sizeof(T));
+        for (size_t i = 0; i < sizeof(T); i++)
+            file.put(static_cast<char>((bits >> (8*i)) & 0xff));
+    }
+
+    void write_string(std::ofstream &file, const std::string &value)
+    {
+        write_le<uint32_t>(file, static_cast<uint32_t>(value.size()));
+        file.write(value.data(), value.size());
+    }
+
+    void write_column_header(std::ofstream &file, const std::string &name, char type, uint64_t size)
+    {
+        write_string(file, name);
+        file.put(type);
+        write_le<uint64_t>(file, size);
+    }
+
+    void write_column(std::ofstream &file, const std::string &name, const std::vector<double> &values)
+    {
+        write_column_header(file, name, 'd', values.size());
+        for (size_t i = 0; i < values.size(); i++)
+            write_le<double>(file, values[i]);
+    }
+
+    void write_column(std::ofstream &file, const std::string &name, const std::vector<int> &values)
+    {
+        write_column_header(file, name, 'i', values.size());
+        for (size_t i = 0; i < values.size(); i++)
+            write_le<int32_t>(file, values[i]);
+    }
+
+    bool is_number(const std::string &value, double &number)
+    {
+        char *end = nullptr;
+        number = strtod(value.c_str(), &end);
+        return end != value.c_str() && *end == '\0';
+    }
+}
+
+
+Batch_runner::Batch_runner(const Parameters &params) : Params(params)
+{
+    std::ifstream table(Params.batch_file_name);
+    if (!table) {
+        std::cerr << "Unable to open file " << Params.batch_file_name << "\n";
+        exit(1);
+    }
+
+    try {
+        std::string line;
+        int line_num = 0;
+        while (std::getline(table, line)) {
+            line_num++;
+            std::istringstream line_stream(line);
+            std::vector<std::string> values;
+            std::string value;
+            while (line_stream >> value)
+                values.push_back(value);
+            if (values.empty() || values[0].compare(0, 2, "//") == 0)
+                continue;
+
+            if (column_names.empty()) {  //the header
+                column_names = values;
+                Parameters test = Params;
+                for (size_t c = 0; c < column_names.size(); c++) {
+                    if (!test.set_value(column_names[c], "1"))
+                        throw std::runtime_error("Unknown parameter " + column_names[c] + " in " + Params.batch_file_name);
+                }
+                continue;
+            }
+
+            if (values.size() != column_names.size())
+                throw std::runtime_error("Line " + std::to_string(line_num) + " of " + Params.batch_file_name + " has "
+                                         + std::to_string(values.size()) + " values, expected " + std::to_string(column_names.size()));
+
+            Parameters row_params = Params;
+            try {
+                for (size_t c = 0; c < column_names.size(); c++)
+                    row_params.set_value(column_names[c], values[c]);
+                row_params.check_values();
+            }
+            catch (std::runtime_error &e) {
+                throw std::runtime_error("Line " + std::to_string(line_num) + " of " + Params.batch_file_name + ": " + e.what());
+            }
+
+            rows.push_back(values);
+            run_params.push_back(row_params);
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+
+    //read each generation rate file once (for each mesh it's used with), not in every run
+    for (size_t r = 0; r < run_params.size(); r++) {
+        std::pair<std::string, int> key(run_params[r].GenRateFileName, run_params[r].num_cell);
+        if (gen_rates.find(key) == gen_rates.end())
+            gen_rates[key] = Photogeneration::read_gen_rate(run_params[r], key.first);
+    }
+
+    std::cout << "Batch of " << run_params.size() << " runs from " << Params.batch_file_name << std::endl;
+}
+
+
+void Batch_runner::run()
+{
+    const int num_runs = static_cast<int>(run_params.size());
+    results.assign(num_runs, DD_result());
+    failed.assign(num_runs, 0);
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    //the runs are independent, and parallel_for hands out the next run to whichever thread is free, so long and short runs balance
+    std::unique_ptr<Thread_pool> thread_pool(new Thread_pool(std::min(Params.num_threads > 0 ? Params.num_threads : Thread_pool::hardware_threads(),
+                                                                       std::max(num_runs, 1))));
+    std::mutex progress_mutex;
+    int num_done = 0;
+    const int progress_interval = std::max(num_runs/20, 1);
+
+    thread_pool->parallel_for(num_runs, [&](int r) {
+        DD_options options;
+        options.gen_rate = &gen_rates.at(std::make_pair(run_params[r].GenRateFileName, run_params[r].num_cell));
+        try {
+            results[r] = solve_DD(run_params[r], options);
+        }
+        catch (std::exception &e) {
+            failed[r] = 1;
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            std::cerr << "Run " << r << " failed: " << e.what() << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        num_done++;
+        if (num_done % progress_interval == 0 || num_done == num_runs)
+            std::cout << num_done << " of " << num_runs << " runs done" << std::endl;
+    });
+
+    std::chrono::duration<double> time = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - start);
+    std::cout << num_runs << " runs on " << thread_pool->size() << " threads in " << time.count() << " s ("
+              << num_runs/time.count() << " runs/s)" << std::endl;
+
+    write_results(Params.batch_output_file_name);
+}
+
+
+void Batch_runner::write_results(const std::string &file_name) const
+{
+    std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Unable to open file " << file_name << "\n";
+        exit(1);
+    }
+
+    const size_t num_runs = results.size();
+    const uint32_t num_columns = static_cast<uint32_t>(column_names.size()) + 8;
+
+    file.write("DDBATCH1", 8);
+    write_le<uint32_t>(file, num_columns);
+
+    //the parameter columns
+    for (size_t c = 0; c < column_names.size(); c++) {
+        std::vector<double> numbers(num_runs);
+        bool numeric = true;
+        for (size_t r = 0; r < num_runs && numeric; r++)
+            numeric = is_number(rows[r][c], numbers[r]);
+
+        if (numeric) {
+            write_column(file, column_names[c], numbers);
+        } else {
+            write_column_header(file, column_names[c], 's', num_runs);
+            for (size_t r = 0; r < num_runs; r++)
+                write_string(file, rows[r][c]);
+        }
+    }
+
+    //per run stats
+    std::vector<int> total_iterations(num_runs), max_iterations(num_runs);
+    std::vector<double> run_time(num_runs);
+    for (size_t r = 0; r < num_runs; r++) {
+        total_iterations[r] = failed[r] ? 0 : results[r].total_iterations;
+        max_iterations[r] = results[r].iterations.empty() ? 0 : *std::max_element(results[r].iterations.begin(), results[r].iterations.end());
+        run_time[r] = failed[r] ? 0.0 : results[r].run_time;
+    }
+    write_column(file, "total_iterations", total_iterations);
+    write_column(file, "max_iterations", max_iterations);
+    write_column(file, "run_time", run_time);
+    write_column(file, "failed", failed);
+
+    //JV curves, concatenated
+    write_column_header(file, "JV_offset", 'u', num_runs + 1);
+    uint64_t offset = 0;
+    write_le<uint64_t>(file, offset);
+    for (size_t r = 0; r < num_runs; r++) {
+        offset += results[r].J.size();
+        write_le<uint64_t>(file, offset);
+    }
+
+    write_column_header(file, "Va", 'd', offset);
+    for (size_t r = 0; r < num_runs; r++)
+        for (size_t k = 0; k < results[r].J.size(); k++)
+            write_le<double>(file, results[r].Va[k]);
+
+    write_column_header(file, "J", 'd', offset);
+    for (size_t r = 0; r < num_runs; r++)
+        for (size_t k = 0; k < results[r].J.size(); k++)
+            write_le<double>(file, results[r].J[k]);
+
+    write_column_header(file, "iterations", 'i', offset);
+    for (size_t r = 0; r < num_runs; r++)
+        for (size_t k = 0; k < results[r].J.size(); k++)
+            write_le<int32_t>(file, results[r].iterations[k]);
+
+    file.close();
+    if (!file) {
+        std::cerr << "Writing " << file_name << " failed\n";
+        exit(1);
+    }
+    std::cout << "Batch results written to " << file_name << std::endl;
+}
@@ -0,0 +1,47 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <utility>
+
+#include "parameters.h"
+#include "run_DD.h"
+
+//!Batch mode: runs many parameter sets in one process, instead of one process per parameters.inp.
+//! The table (params.batch_file_name) has the names of the parameters to change in the 1st row (as in Parameters::set_value)
+//! and one row of values per run; all other parameters are taken from parameters.inp. Lines starting with // are skipped.
+//! The runs are scheduled on a thread pool (params.num_threads), and each generation rate file is read only once.
+//! All results are written to one binary file (params.batch_output_file_name), see write_results.
+class Batch_runner
+{
+public:
+    //!Reads the table. Exits if it can't be read or has invalid values.
+    Batch_runner(const Parameters &params);
+
+    //!Runs all parameter sets and writes the results
+    void run();
+
+private:
+    const Parameters &Params;
+
+    std::vector<std::string> column_names;
+    std::vector<std::vector<std::string> > rows;   //the values as given in the table, for the output
+    std::vector<Parameters> run_params;
+
+    std::map<std::pair<std::string, int>, std::vector<double> > gen_rates;  //generation rate profile for each (file, num_cell)
+
+    std::vector<DD_result> results;
+    std::vector<int> failed;   //1 if the run threw an exception
+
+    //!Writes the results as named columns (columnar layout): a header "DDBATCH1" and the # of columns (uint32), then for each
+    //! column its name (uint32 length + chars), type ('d' = double, 'i' = int32, 'u' = uint64, 's' = string), # of entries (uint64)
+    //! and the entries (strings as uint32 length + chars). Everything is little endian. The columns are the table's parameter
+    //! columns (as double if all values are numbers, else as string), total_iterations, max_iterations, run_time and failed
+    //! (one entry per run), and the JV curves of all runs concatenated in Va, J and iterations, where run i has the entries
+    //! JV_offset[i] to JV_offset[i+1]-1.
+    void write_results(const std::string &file_name) const;
+};
+
+#endif // BATCH_H
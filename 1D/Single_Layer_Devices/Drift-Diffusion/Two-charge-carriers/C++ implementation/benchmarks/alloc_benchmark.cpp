@@ -0,0 +1,59 @@
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%  Allocation count benchmark for the Gummel iterations of the 1D solver.
+%
+%     Built with DD_TRACK_ALLOCATIONS, so alloc_tracking.cpp replaces the global
+%     operator new/delete with versions which count the heap allocations. Then
+%     runs solve_DD (without any output) with linear and with Anderson mixing and
+%     reports the most allocations of a Gummel iteration after the 1st of a voltage
+%     (the steady state), which should be 0.
+%
+%     Usage: alloc_benchmark [budget]   (allowed allocations per iteration, default 0)
+%     Run from a directory containing parameters.inp and the generation rate file
+%     (i.e. the 1D source directory). Returns 1 if any iteration exceeded the budget.
+%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+
+#include <iostream>
+#include <cstdlib>
+
+#include "parameters.h"
+#include "run_DD.h"
+#include "alloc_tracking.h"
+
+
+//!Runs solve_DD with \param mixing_method and prints its allocations. Returns the run's result.
+DD_result run(Parameters params, int mixing_method, const char *name)
+{
+    params.solver_method = 1;
+    params.mixing_method = mixing_method;
+    DD_result result = solve_DD(params);   //default options: no files written
+
+    std::cout << name << ": " << result.total_iterations << " iterations, " << result.allocations.allocations
+              << " allocations (" << result.allocations.bytes << " bytes) in the run, at most "
+              << result.max_iteration_allocations.allocations << " (" << result.max_iteration_allocations.bytes
+              << " bytes) in a steady state iteration" << std::endl;
+    return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (!Alloc_tracking::compiled()) {
+        std::cerr << "alloc_benchmark must be built with DD_TRACK_ALLOCATIONS (see alloc_benchmark.pro)" << std::endl;
+        return 1;
+    }
+    const long long budget = (argc > 1) ? std::atoll(argv[1]) : 0;
+
+    Parameters params;
+    params.Initialize();
+    std::cout << "num_cell = " << params.num_cell << ", Va = " << params.Va_min << " to " << params.Va_max
+              << ", budget = " << budget << " allocations per iteration" << std::endl;
+
+    DD_result linear = run(params, 1, "linear mixing");
+    DD_result anderson = run(params, 2, "Anderson mixing");
+
+    const bool within_budget = linear.max_iteration_allocations.allocations <= budget
+                               && anderson.max_iteration_allocations.allocations <= budget;
+    std::cout << (within_budget ? "PASSED" : "FAILED: an iteration exceeded the allocation budget") << std::endl;
+    return within_budget ? 0 : 1;
+}
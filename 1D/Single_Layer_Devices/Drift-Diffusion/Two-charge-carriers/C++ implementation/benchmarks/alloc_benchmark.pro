@@ -0,0 +1,28 @@
+TEMPLATE = app
+CONFIG += console c++11 thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+INCLUDEPATH += ..
+DEFINES += DD_TRACK_ALLOCATIONS
+
+SOURCES += \
+    alloc_benchmark.cpp \
+    ../photogeneration.cpp \
+    ../recombination.cpp \
+    ../thomas_tridiag_solve.cpp \
+    ../block_tridiag_solve.cpp \
+    ../poisson.cpp \
+    ../continuity_n.cpp \
+    ../continuity_p.cpp \
+    ../parameters.cpp \
+    ../Utilities.cpp \
+    ../run_DD.cpp \
+    ../newton.cpp \
+    ../anderson_mix.cpp \
+    ../snapshot_file.cpp \
+    ../output_policy.cpp \
+    ../phase_timer.cpp \
+    ../hw_counters.cpp \
+    ../trace.cpp \
+    ../alloc_tracking.cpp
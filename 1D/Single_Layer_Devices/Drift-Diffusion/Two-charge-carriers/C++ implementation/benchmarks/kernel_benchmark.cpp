@@ -0,0 +1,232 @@
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%  Microbenchmarks of the kernels of the 1D solver for a range of mesh sizes.
+%
+%     Times Thomas_solve, Thomas_factor::factorize and solve, Continuity_n/p::setup_eqn,
+%     Poisson::set_rhs, Recombo::ComputeR_Langevin, Utilities::linear_mix and a full
+%     Gummel iteration (same steps as in run_DD.cpp, linear mixing) for
+%     num_cell = 100, 1000, ... up to max_num_cell, and prints for each the time
+%     per mesh node and the memory bandwidth.
+%
+%     The bandwidth is computed from a traffic model: each array read or written
+%     by a loop of the kernel counts as 8 bytes per node (see the bytes_per_node
+%     of each kernel), so it is the bandwidth the kernel would need from memory
+%     if none of its arrays were cached. Each kernel is called repeatedly in
+%     batches of ~20 ms and the fastest of 5 batches is reported.
+%
+%     Usage: kernel_benchmark [max_num_cell]   (default 1000000)
+%     Run from a directory containing parameters.inp and the generation rate file
+%     (i.e. the 1D source directory), which give the device parameters.
+%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <numeric>
+#include <cstdlib>
+#include <cmath>
+
+#include "constants.h"
+#include "parameters.h"
+#include "poisson.h"
+#include "continuity_p.h"
+#include "continuity_n.h"
+#include "recombination.h"
+#include "photogeneration.h"
+#include "thomas_tridiag_solve.h"
+#include "Utilities.h"
+
+namespace {
+    //!A benchmarked kernel: \param run does one call for the whole mesh
+    struct Kernel
+    {
+        const char *name;
+        double bytes_per_node;   //traffic model: 8 bytes for each array read or written by each loop
+        std::function<void()> run;
+    };
+
+    //!The solver state at one mesh size, set up like at the start of a voltage in run_DD (Va = 0.5, uniform generation)
+    struct Solver_state
+    {
+        Parameters params;
+        Poisson poisson;
+        Recombo recombo;
+        Continuity_p continuity_p;
+        Continuity_n continuity_n;
+        Utilities utils;
+        Thomas_factor poisson_factor, continuity_n_factor, continuity_p_factor;
+        double V_leftBC, V_rightBC;
+
+        std::vector<double> n, p, oldp, newp, oldn, newn;
+        std::vector<double> oldV, newV, V;
+        std::vector<double> Un, Up, PhotogenRate, error_np_vector;
+        std::vector<double> thomas_rhs, thomas_rhs_copy, thomas_x, mixed;
+        double error_checksum;   //sum of the errors of the Gummel iterations, printed so that their calculation is kept
+
+        Solver_state(const Parameters &params_in, double gen_rate)
+            : params(params_in), poisson(params), recombo(params), continuity_p(params), continuity_n(params),
+              n(params.num_cell), p(params.num_cell), oldp(params.num_cell), newp(params.num_cell), oldn(params.num_cell), newn(params.num_cell),
+              oldV(params.num_cell+1), newV(params.num_cell+1), V(params.num_cell+1),
+              Un(params.num_cell), Up(params.num_cell), PhotogenRate(params.num_cell, gen_rate), error_np_vector(params.num_cell),
+              error_checksum(0)
+        {
+            const int num_cell = params.num_cell;
+            const double Va = 0.5;
+            const double Vbi = params.WF_anode - params.WF_cathode + params.phi_a + params.phi_c;
+            params.use_w_i();
+
+            const double min_dense = std::min(continuity_n.get_n_leftBC(), continuity_p.get_p_rightBC());
+            std::fill(n.begin()+1, n.end(), min_dense);
+            std::fill(p.begin()+1, p.end(), min_dense);
+            V_leftBC = -((Vbi-Va)/(2*Vt) - params.phi_a/Vt);
+            V_rightBC = (Vbi-Va)/(2*Vt) - params.phi_c/Vt;
+            for (int i = 0; i <= num_cell; i++)
+                V[i] = V_leftBC + (V_rightBC - V_leftBC)*i/num_cell;
+            for (int i = 1; i < num_cell; i++)
+                Un[i] = PhotogenRate[i];
+            Up = Un;
+
+            poisson.setup_matrix();
+            poisson_factor.factorize(poisson.get_main_diag(), poisson.get_upper_diag(), poisson.get_lower_diag());
+            continuity_n.setup_eqn(V, Un);
+            continuity_n_factor.factorize(continuity_n.get_main_diag(), continuity_n.get_upper_diag(), continuity_n.get_lower_diag());
+            continuity_p.setup_eqn(V, Up);
+            continuity_p_factor.factorize(continuity_p.get_main_diag(), continuity_p.get_upper_diag(), continuity_p.get_lower_diag());
+
+            thomas_rhs = continuity_n.get_rhs();
+            thomas_x.resize(num_cell+1);
+            mixed.resize(num_cell);
+        }
+
+        //!One Gummel iteration with linear mixing, same steps as in run_DD. Returns error_np.
+        double gummel_iteration()
+        {
+            const int num_cell = params.num_cell;
+
+            poisson.set_rhs(n, p, V_leftBC, V_rightBC);
+            oldV = V;
+            poisson_factor.solve(poisson.get_rhs(), newV);
+            newV[0] = V[0];
+            newV[num_cell] = V[num_cell];
+            utils.linear_mix(params, newV, oldV, V);
+            V[0] = V_leftBC;
+            V[num_cell] = V_rightBC;
+
+            const std::vector<double> &R_Langevin = recombo.ComputeR_Langevin(params, n, p);
+            for (int i = 1; i < num_cell; i++)
+                Un[i] = PhotogenRate[i] - R_Langevin[i];
+            Up = Un;
+
+            continuity_n.setup_eqn(V, Un);
+            oldn = n;
+            continuity_n_factor.factorize(continuity_n.get_main_diag(), continuity_n.get_upper_diag(), continuity_n.get_lower_diag());
+            continuity_n_factor.solve(continuity_n.get_rhs(), newn);
+
+            continuity_p.setup_eqn(V, Up);
+            oldp = p;
+            continuity_p_factor.factorize(continuity_p.get_main_diag(), continuity_p.get_upper_diag(), continuity_p.get_lower_diag());
+            continuity_p_factor.solve(continuity_p.get_rhs(), newp);
+
+            for (int i = 1; i < num_cell; i++) {
+                if (newp[i] < 0.0) newp[i] = 0;
+                if (newn[i] < 0.0) newn[i] = 0;
+            }
+            for (int i = 1; i < num_cell; i++) {
+                if (newp[i]!=0 && newn[i] !=0)
+                    error_np_vector[i] = (std::abs(newp[i]-oldp[i]) + std::abs(newn[i]-oldn[i]))/std::abs(oldp[i]+oldn[i]);
+            }
+            const double error_np = *std::max_element(error_np_vector.begin(), error_np_vector.end());
+            std::fill(error_np_vector.begin(), error_np_vector.end(), 0.0);
+
+            utils.linear_mix(params, newp, oldp, p);
+            utils.linear_mix(params, newn, oldn, n);
+            p[0] = continuity_p.get_p_leftBC();
+            n[0] = continuity_n.get_n_leftBC();
+            return error_np;
+        }
+    };
+
+    //!Seconds per call of \param kernel: the fastest of 5 batches of calls, each batch taking about 20 ms
+    double time_per_call(const Kernel &kernel)
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        kernel.run();   //warm up (caches, page faults)
+        Clock::time_point start = Clock::now();
+        kernel.run();
+        const double single = std::chrono::duration<double>(Clock::now() - start).count();
+        const long calls = std::max(1L, static_cast<long>(0.02/std::max(single, 1e-9)));
+
+        double best = 1e300;
+        for (int batch = 0; batch < 5; batch++) {
+            start = Clock::now();
+            for (long call = 0; call < calls; call++)
+                kernel.run();
+            best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count()/calls);
+        }
+        return best;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    const long max_num_cell = (argc > 1) ? std::atol(argv[1]) : 1000000;
+    if (max_num_cell < 100) {
+        std::cerr << "max_num_cell must be >= 100" << std::endl;
+        return 1;
+    }
+
+    Parameters params;
+    params.Initialize();
+    //uniform generation rate with the average of the generation rate file (which is for the num_cell of parameters.inp)
+    Photogeneration photogen(params, params.Photogen_scaling, params.GenRateFileName);
+    const std::vector<double> &gen_rate = photogen.getPhotogenRate();
+    const double average_gen_rate = std::accumulate(gen_rate.begin()+1, gen_rate.end(), 0.0)/(params.num_cell-1);
+
+    std::cout << "#kernel num_cell ns_per_node GB_per_s" << std::endl;
+    for (long num_cell = 100; num_cell <= max_num_cell; num_cell *= 10) {
+        Parameters mesh_params = params;
+        mesh_params.num_cell = static_cast<int>(num_cell);
+        mesh_params.dx = params.L/num_cell;
+        Solver_state state(mesh_params, average_gen_rate);
+        Solver_state *s = &state;
+
+        const std::vector<Kernel> kernels = {
+            //copy of the rhs (which Thomas_solve changes) 16, copy of the diagonal 16, forward 48, backward 32, zeroed result 8
+            {"Thomas_solve", 120, [s]() {
+                s->thomas_rhs_copy = s->thomas_rhs;
+                s->thomas_x = Thomas_solve(s->continuity_n.get_main_diag(), s->continuity_n.get_upper_diag(),
+                                           s->continuity_n.get_lower_diag(), s->thomas_rhs_copy);}},
+            //copies of the diagonals 32, elimination 40
+            {"Thomas_factor::factorize", 72, [s]() {
+                s->continuity_n_factor.factorize(s->continuity_n.get_main_diag(), s->continuity_n.get_upper_diag(),
+                                                 s->continuity_n.get_lower_diag());}},
+            //forward 24, backward 32
+            {"Thomas_factor::solve", 56, [s]() {s->continuity_n_factor.solve(s->continuity_n.get_rhs(), s->newn);}},
+            //Bernoulli 24, main diagonal 32, upper and lower diagonals 48, rhs 16
+            {"Continuity_n::setup_eqn", 120, [s]() {s->continuity_n.setup_eqn(s->V, s->Un);}},
+            {"Continuity_p::setup_eqn", 120, [s]() {s->continuity_p.setup_eqn(s->V, s->Up);}},
+            {"Poisson::set_rhs", 24, [s]() {s->poisson.set_rhs(s->n, s->p, s->V_leftBC, s->V_rightBC);}},
+            {"Recombo::ComputeR_Langevin", 24, [s]() {s->recombo.ComputeR_Langevin(s->params, s->n, s->p);}},
+            {"Utilities::linear_mix", 24, [s]() {s->utils.linear_mix(s->params, s->newn, s->oldn, s->mixed);}},
+            //the sum of the steps: Poisson 24+16+56+24, net generation 24+24+16, continuity 2*(120+16+72+56),
+            //clamping and error 32+40+8+8, mixing 48
+            {"Gummel_iteration", 848, [s]() {s->error_checksum += s->gummel_iteration();}}
+        };
+
+        for (const Kernel &kernel : kernels) {
+            const double time = time_per_call(kernel);
+            std::cout << std::left << std::setw(28) << kernel.name << std::right << std::setw(9) << num_cell
+                      << std::fixed << std::setprecision(3) << std::setw(10) << 1e9*time/num_cell
+                      << std::setw(10) << kernel.bytes_per_node*num_cell/time/1e9
+                      << std::defaultfloat << std::endl;
+        }
+        std::cout << "#checksum of the Gummel iteration errors: " << state.error_checksum << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+CONFIG -= qt
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    kernel_benchmark.cpp \
+    ../photogeneration.cpp \
+    ../recombination.cpp \
+    ../thomas_tridiag_solve.cpp \
+    ../poisson.cpp \
+    ../continuity_n.cpp \
+    ../continuity_p.cpp \
+    ../parameters.cpp \
+    ../Utilities.cpp \
+    ../output_policy.cpp \
+    ../phase_timer.cpp \
+    ../hw_counters.cpp \
+    ../alloc_tracking.cpp
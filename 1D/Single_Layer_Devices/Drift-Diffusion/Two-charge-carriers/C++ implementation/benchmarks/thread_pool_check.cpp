@@ -0,0 +1,60 @@
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%  Fairness check of Thread_pool::run_work_stealing.
+%
+%     Runs 10 tasks which are queued again until 200 runs were done in total
+%     (like the particles of the asynchronous PSO), with 1, 2 and 4 threads, and
+%     each run taking 1 ms (so all threads run, even on a single core), and
+%     checks that every task got a fair share of the runs: at least half of the
+%     average. Returns 1 if a task was starved.
+%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+#include "thread_pool.h"
+
+
+//!Returns true if all tasks ran at least half of the average # of times, with \param num_threads threads
+bool check(int num_threads)
+{
+    const int num_tasks = 10, total_runs = 200;
+    Thread_pool pool(num_threads);
+    std::vector<std::atomic<int> > runs(num_tasks);
+    for (int i = 0; i < num_tasks; i++)
+        runs[i] = 0;
+    std::atomic<int> total(0);
+
+    std::vector<int> task_ids(num_tasks);
+    for (int i = 0; i < num_tasks; i++)
+        task_ids[i] = i;
+    pool.run_work_stealing(task_ids, [&](int id) {
+        runs[id]++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return ++total < total_runs;
+    });
+
+    int min_runs = total_runs, max_runs = 0;
+    for (int i = 0; i < num_tasks; i++) {
+        min_runs = std::min(min_runs, runs[i].load());
+        max_runs = std::max(max_runs, runs[i].load());
+    }
+    const bool fair = (min_runs >= total_runs/num_tasks/2);
+    std::cout << num_threads << " threads: " << total << " runs, each task ran " << min_runs << " to " << max_runs
+              << " times" << (fair ? "" : " -- a task was starved") << std::endl;
+    return fair;
+}
+
+
+int main()
+{
+    bool fair = true;
+    for (int num_threads : {1, 2, 4})
+        fair = check(num_threads) && fair;
+    std::cout << (fair ? "PASSED" : "FAILED") << std::endl;
+    return fair ? 0 : 1;
+}
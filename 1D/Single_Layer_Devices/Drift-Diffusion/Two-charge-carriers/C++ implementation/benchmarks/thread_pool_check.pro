@@ -0,0 +1,10 @@
+TEMPLATE = app
+CONFIG += console c++11 thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    thread_pool_check.cpp \
+    ../thread_pool.cpp
@@ -0,0 +1,88 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>   //for swap
+
+#include "block_tridiag_solve.h"
+
+//!Inverts the 3x3 block A (row-major) in place, using Gauss-Jordan elimination with partial pivoting.
+//! Returns false if the block is singular.
+static bool invert_3x3(double *A)
+{
+    double inv[9] = {1,0,0, 0,1,0, 0,0,1};
+    double M[9];
+    for (int k = 0; k < 9; k++) M[k] = A[k];
+
+    for (int col = 0; col < 3; col++) {
+        //find the pivot row
+        int pivot = col;
+        for (int row = col+1; row < 3; row++)
+            if (std::abs(M[3*row+col]) > std::abs(M[3*pivot+col])) pivot = row;
+        if (M[3*pivot+col] == 0.0) return false;
+
+        if (pivot != col) {
+            for (int k = 0; k < 3; k++) {
+                std::swap(M[3*col+k], M[3*pivot+k]);
+                std::swap(inv[3*col+k], inv[3*pivot+k]);
+            }
+        }
+        double pivot_inv = 1.0/M[3*col+col];
+        for (int k = 0; k < 3; k++) {
+            M[3*col+k] *= pivot_inv;
+            inv[3*col+k] *= pivot_inv;
+        }
+        for (int row = 0; row < 3; row++) {
+            if (row == col) continue;
+            double factor = M[3*row+col];
+            for (int k = 0; k < 3; k++) {
+                M[3*row+k] -= factor*M[3*col+k];
+                inv[3*row+k] -= factor*inv[3*col+k];
+            }
+        }
+    }
+    for (int k = 0; k < 9; k++) A[k] = inv[k];
+
+    return true;
+}
+
+//C = A*B for 3x3 row-major blocks
+static void mult_3x3(const double *A, const double *B, double *C)
+{
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 3; col++)
+            C[3*row+col] = A[3*row]*B[col] + A[3*row+1]*B[3+col] + A[3*row+2]*B[6+col];
+}
+
+//y = A*x for a 3x3 row-major block
+static void mult_3x3_vec(const double *A, const double *x, double *y)
+{
+    for (int row = 0; row < 3; row++)
+        y[row] = A[3*row]*x[0] + A[3*row+1]*x[1] + A[3*row+2]*x[2];
+}
+
+//!\author Timofey  Golubev
+
+bool Block_Thomas_solve(const std::vector<double> &lower, std::vector<double> &diag, const std::vector<double> &upper, std::vector<double> &rhs, std::vector<double> &x, int num_blocks)
+{
+    double W[9], WU[9], Wr[3];
+
+    //Forward elimination: D'_i = D_i - L_i*inv(D'_i-1)*U_i-1, r'_i = r_i - L_i*inv(D'_i-1)*r'_i-1
+    if (!invert_3x3(&diag[9])) return false;
+    for (int i = 2; i <= num_blocks; i++) {
+        mult_3x3(&lower[9*i], &diag[9*(i-1)], W);   //diag[i-1] already holds its inverse
+        mult_3x3(W, &upper[9*(i-1)], WU);
+        mult_3x3_vec(W, &rhs[3*(i-1)], Wr);
+        for (int k = 0; k < 9; k++) diag[9*i+k] -= WU[k];
+        for (int k = 0; k < 3; k++) rhs[3*i+k] -= Wr[k];
+        if (!invert_3x3(&diag[9*i])) return false;
+    }
+
+    //Backward substitution
+    mult_3x3_vec(&diag[9*num_blocks], &rhs[3*num_blocks], &x[3*num_blocks]);
+    for (int i = num_blocks-1; i >= 1; i--) {
+        mult_3x3_vec(&upper[9*i], &x[3*(i+1)], Wr);
+        for (int k = 0; k < 3; k++) Wr[k] = rhs[3*i+k] - Wr[k];
+        mult_3x3_vec(&diag[9*i], Wr, &x[3*i]);
+    }
+
+    return true;
+}
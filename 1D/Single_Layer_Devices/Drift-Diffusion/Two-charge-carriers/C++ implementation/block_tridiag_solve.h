@@ -0,0 +1,16 @@
+#ifndef BLOCK_TRIDIAG_SOLVE_H
+#define BLOCK_TRIDIAG_SOLVE_H
+
+#include<vector>
+
+//!This function uses the block Thomas algorithm for a block tridiagonal matrix with 3x3 blocks.
+//! Each block is stored row-major (9 entries per block) and blocks are indexed from 1 to num_blocks, like in Thomas_solve.
+//! lower = blocks coupling row block i to unknowns at i-1. indices (L2....Ln)
+//! diag = blocks on the main diagonal. indices (D1....Dn)
+//! upper = blocks coupling row block i to unknowns at i+1. indices (U1....U_n-1)
+//! rhs and x have 3 entries per block, stored starting at 3*i.
+//! NOTE: diag and rhs are overwritten (diag with the inverted pivot blocks). Returns false if a pivot block is singular.
+bool Block_Thomas_solve(const std::vector<double> &lower, std::vector<double> &diag, const std::vector<double> &upper, std::vector<double> &rhs, std::vector<double> &x, int num_blocks);
+
+
+#endif // BLOCK_TRIDIAG_SOLVE_H
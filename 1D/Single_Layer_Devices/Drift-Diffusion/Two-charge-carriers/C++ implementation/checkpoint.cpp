@@ -0,0 +1,240 @@
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    const char magic[8] = {'D', 'D', 'C', 'K', 'P', 'T', '0', '1'};
+
+    //FNV-1a hash, to detect a damaged checkpoint file
+    uint64_t checksum(const std::vector<char> &bytes)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < bytes.size(); i++) {
+            hash ^= static_cast<unsigned char>(bytes[i]);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+
+void Checkpoint_data::put_raw(const void *data, size_t size)
+{
+    const char *begin = static_cast<const char*>(data);
+    bytes.insert(bytes.end(), begin, begin + size);
+}
+
+void Checkpoint_data::get_raw(void *data, size_t size)
+{
+    if (pos + size > bytes.size())
+        throw std::runtime_error("Checkpoint is shorter than expected.");
+    memcpy(data, &bytes[pos], size);
+    pos += size;
+}
+
+void Checkpoint_data::put(int value) {put_raw(&value, sizeof(value));}
+void Checkpoint_data::put(double value) {put_raw(&value, sizeof(value));}
+
+void Checkpoint_data::put(const std::vector<double> &values)
+{
+    put(static_cast<int>(values.size()));
+    if (!values.empty())
+        put_raw(&values[0], values.size()*sizeof(double));
+}
+
+void Checkpoint_data::put(const std::string &value)
+{
+    put(static_cast<int>(value.size()));
+    put_raw(value.data(), value.size());
+}
+
+//the standard random number engines can be written to and read from streams as text
+void Checkpoint_data::put(const std::mt19937 &generator)
+{
+    std::ostringstream state;
+    state << generator;
+    put(state.str());
+}
+
+void Checkpoint_data::put(const std::default_random_engine &generator)
+{
+    std::ostringstream state;
+    state << generator;
+    put(state.str());
+}
+
+int Checkpoint_data::get_int()
+{
+    int value;
+    get_raw(&value, sizeof(value));
+    return value;
+}
+
+double Checkpoint_data::get_double()
+{
+    double value;
+    get_raw(&value, sizeof(value));
+    return value;
+}
+
+std::vector<double> Checkpoint_data::get_vector()
+{
+    int size = get_int();
+    if (size < 0 || static_cast<size_t>(size) > (bytes.size() - pos)/sizeof(double))
+        throw std::runtime_error("Invalid vector size in checkpoint.");
+    std::vector<double> values(size);
+    if (size > 0)
+        get_raw(&values[0], size*sizeof(double));
+    return values;
+}
+
+std::string Checkpoint_data::get_string()
+{
+    int size = get_int();
+    if (size < 0 || static_cast<size_t>(size) > bytes.size() - pos)
+        throw std::runtime_error("Invalid string size in checkpoint.");
+    std::string value(size, ' ');
+    if (size > 0)
+        get_raw(&value[0], size);
+    return value;
+}
+
+void Checkpoint_data::get(std::mt19937 &generator)
+{
+    std::istringstream state(get_string());
+    state >> generator;
+}
+
+void Checkpoint_data::get(std::default_random_engine &generator)
+{
+    std::istringstream state(get_string());
+    state >> generator;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------------------
+Checkpoint_writer::Checkpoint_writer(const std::string &file_name) : file_name(file_name), has_pending(false), stop(false)
+{
+    worker = std::thread(&Checkpoint_writer::worker_loop, this);
+}
+
+
+Checkpoint_writer::~Checkpoint_writer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+
+void Checkpoint_writer::write(Checkpoint_data &&data)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(data);
+        has_pending = true;
+    }
+    cv.notify_all();
+}
+
+
+void Checkpoint_writer::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this]{return has_pending || stop;});
+        if (!has_pending)
+            return;   //stop, and everything is written
+
+        Checkpoint_data data = std::move(pending);
+        has_pending = false;
+
+        lock.unlock();
+        try {
+            write_file(data);
+        }
+        catch (std::exception &e) {
+            std::cerr << "Writing the checkpoint failed: " << e.what() << std::endl;  //the fit can continue without it
+        }
+        lock.lock();
+    }
+}
+
+
+void Checkpoint_writer::write_file(const Checkpoint_data &data) const
+{
+    const std::string temp_name = file_name + ".tmp";
+
+    //written with stdio, so the file can be synced to the disk before it replaces the old checkpoint
+    FILE *file = std::fopen(temp_name.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("Unable to open file " + temp_name);
+
+    uint64_t size = data.bytes.size();
+    uint64_t hash = checksum(data.bytes);
+    bool ok = std::fwrite(magic, sizeof(magic), 1, file) == 1
+              && std::fwrite(&size, sizeof(size), 1, file) == 1
+              && (size == 0 || std::fwrite(&data.bytes[0], size, 1, file) == 1)
+              && std::fwrite(&hash, sizeof(hash), 1, file) == 1
+              && std::fflush(file) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(file)) == 0;
+#else
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok)
+        throw std::runtime_error("Unable to write file " + temp_name);
+
+    //rename doesn't replace an existing file on all systems
+    if (std::rename(temp_name.c_str(), file_name.c_str()) != 0) {
+        std::remove(file_name.c_str());
+        if (std::rename(temp_name.c_str(), file_name.c_str()) != 0)
+            throw std::runtime_error("Unable to rename " + temp_name + " to " + file_name);
+    }
+}
+
+
+bool Checkpoint_writer::read(const std::string &file_name, Checkpoint_data &data)
+{
+    std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    const uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    char file_magic[sizeof(magic)];
+    uint64_t size = 0, hash = 0;
+    if (!file.read(file_magic, sizeof(file_magic)) || memcmp(file_magic, magic, sizeof(magic)) != 0)
+        throw std::runtime_error(file_name + " is not a checkpoint file.");
+    if (!file.read(reinterpret_cast<char*>(&size), sizeof(size)))
+        throw std::runtime_error("Checkpoint " + file_name + " is truncated.");
+    //check the size before allocating it, a damaged size could be huge
+    const uint64_t header_size = sizeof(magic) + sizeof(size);
+    if (size > file_size - header_size || file_size - header_size - size < sizeof(hash))
+        throw std::runtime_error("Checkpoint " + file_name + " is truncated.");
+
+    data = Checkpoint_data();
+    data.bytes.resize(size);
+    if ((size > 0 && !file.read(&data.bytes[0], size)) || !file.read(reinterpret_cast<char*>(&hash), sizeof(hash)))
+        throw std::runtime_error("Checkpoint " + file_name + " is truncated.");
+    if (hash != checksum(data.bytes))
+        throw std::runtime_error("Checkpoint " + file_name + " is damaged (checksum mismatch).");
+
+    return true;
+}
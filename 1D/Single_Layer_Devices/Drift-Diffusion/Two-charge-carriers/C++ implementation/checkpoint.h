@@ -0,0 +1,70 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//!Binary buffer holding the state of an optimizer, for checkpoints. Values are stored in native byte order, so a checkpoint
+//! is only read back on the same kind of machine. get_... throws std::runtime_error if the buffer is too short.
+class Checkpoint_data
+{
+public:
+    Checkpoint_data() : pos(0) {}
+
+    void put(int value);
+    void put(double value);
+    void put(const std::vector<double> &values);
+    void put(const std::string &value);
+    void put(const std::mt19937 &generator);           //the full state of the random number stream
+    void put(const std::default_random_engine &generator);
+
+    int get_int();
+    double get_double();
+    std::vector<double> get_vector();
+    std::string get_string();
+    void get(std::mt19937 &generator);
+    void get(std::default_random_engine &generator);
+
+    std::vector<char> bytes;
+
+private:
+    size_t pos;   //read position
+
+    void put_raw(const void *data, size_t size);
+    void get_raw(void *data, size_t size);
+};
+
+
+//!Writes checkpoints on a background thread, so the optimizer doesn't wait for the disk. Only the newest checkpoint is kept:
+//! if a new one is given while the previous is still waiting, the previous is dropped. Each checkpoint is written to a
+//! temporary file which then replaces the old checkpoint, so a crash during a write leaves the previous checkpoint intact.
+class Checkpoint_writer
+{
+public:
+    explicit Checkpoint_writer(const std::string &file_name);
+    ~Checkpoint_writer();   //writes the waiting checkpoint (if any) before returning
+
+    //!Queues \param data for writing and returns immediately
+    void write(Checkpoint_data &&data);
+
+    //!Reads the checkpoint \param file_name into \param data. Returns false if the file doesn't exist, throws std::runtime_error
+    //! if it is not a valid checkpoint (e.g. truncated).
+    static bool read(const std::string &file_name, Checkpoint_data &data);
+
+private:
+    std::string file_name;
+    Checkpoint_data pending;
+    bool has_pending, stop;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::thread worker;
+
+    void worker_loop();
+    void write_file(const Checkpoint_data &data) const;
+};
+
+#endif // CHECKPOINT_H
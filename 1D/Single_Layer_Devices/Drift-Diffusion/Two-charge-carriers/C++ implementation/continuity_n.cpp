@@ -1,4 +1,5 @@
 #include "continuity_n.h"
+#include "phase_timer.h"
 
 Continuity_n::Continuity_n(const Parameters &params)
 {
@@ -19,7 +20,10 @@ Continuity_n::Continuity_n(const Parameters &params)
 //Calculates Bernoulli fnc values, then sets the diagonals and rhs
 void Continuity_n::setup_eqn(const std::vector<double> &V, const std::vector<double> &Un)
 {
-    BernoulliFnc_n(V);
+    {
+        TIME_PHASE(Phase::bernoulli);
+        BernoulliFnc_n(V);
+    }
     set_main_diag();
     set_upper_diag();
     set_lower_diag();
@@ -67,15 +71,10 @@ void Continuity_n::set_rhs(const std::vector<double> &Un)
 void Continuity_n::BernoulliFnc_n(const std::vector<double> &V)
 {
 
-    std::vector<double> dV(V.size());
-
-    for (int i = 1; i < V.size(); i++) {
-        dV[i] =  V[i]-V[i-1];
-    }
-
     for (int i = 1; i < V.size(); i++) {
-        B_n1[i] = dV[i]/(exp(dV[i]) - 1.0);
-        B_n2[i] = B_n1[i]*exp(dV[i]);
+        double dV = V[i]-V[i-1];
+        B_n1[i] = dV/(exp(dV) - 1.0);
+        B_n2[i] = B_n1[i]*exp(dV);
     }
 }
 
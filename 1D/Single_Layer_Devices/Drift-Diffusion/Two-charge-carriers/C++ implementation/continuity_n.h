@@ -16,13 +16,13 @@ public:
     void setup_eqn(const std::vector<double> &V, const std::vector<double> &Un);
 
     //getters (const keyword ensures that fnc doesn't change anything)
-    std::vector<double> get_main_diag() const {return main_diag;}
-    std::vector<double> get_upper_diag() const {return upper_diag;}
-    std::vector<double> get_lower_diag() const {return lower_diag;}
-    std::vector<double> get_rhs() const {return rhs;}
-    std::vector<double> get_n_mob() const {return n_mob;}
-    std::vector<double> get_B_n1() const {return B_n1;}
-    std::vector<double> get_B_n2() const {return B_n2;}
+    const std::vector<double> &get_main_diag() const {return main_diag;}
+    const std::vector<double> &get_upper_diag() const {return upper_diag;}
+    const std::vector<double> &get_lower_diag() const {return lower_diag;}
+    const std::vector<double> &get_rhs() const {return rhs;}
+    const std::vector<double> &get_n_mob() const {return n_mob;}
+    const std::vector<double> &get_B_n1() const {return B_n1;}
+    const std::vector<double> &get_B_n2() const {return B_n2;}
     double get_n_leftBC() const {return n_leftBC;}
     double get_n_rightBC() const {return n_rightBC;}
 
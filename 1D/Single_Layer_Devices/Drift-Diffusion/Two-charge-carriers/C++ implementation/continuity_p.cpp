@@ -1,4 +1,5 @@
 #include "continuity_p.h"
+#include "phase_timer.h"
 
 Continuity_p::Continuity_p(const Parameters &params)
 {
@@ -19,7 +20,10 @@ Continuity_p::Continuity_p(const Parameters &params)
 //Calculates Bernoulli fnc values, then sets the diagonals and rhs
 void Continuity_p::setup_eqn(const std::vector<double> &V, const std::vector<double> &Up)
 {
-    BernoulliFnc_p(V);
+    {
+        TIME_PHASE(Phase::bernoulli);
+        BernoulliFnc_p(V);
+    }
     set_main_diag();
     set_upper_diag();
     set_lower_diag();
@@ -65,14 +69,9 @@ void Continuity_p::set_rhs(const std::vector<double> &Up)
 
 void Continuity_p::BernoulliFnc_p(const std::vector<double> &V)
 {
-    std::vector<double> dV(V.size());
-
-    for (int i = 1; i < V.size(); i++) {
-        dV[i] =  V[i]-V[i-1];
-    }
-
     for (int i = 1; i < V.size(); i++) {
-        B_p1[i] = dV[i]/(exp(dV[i]) - 1.0);
-        B_p2[i] = B_p1[i]*exp(dV[i]);
+        double dV = V[i]-V[i-1];
+        B_p1[i] = dV/(exp(dV) - 1.0);
+        B_p2[i] = B_p1[i]*exp(dV);
     }
 }
@@ -16,13 +16,13 @@ public:
     void setup_eqn(const std::vector<double> &V, const std::vector<double> & Up);
 
     //getters
-    std::vector<double> get_main_diag() const {return main_diag;}
-    std::vector<double> get_upper_diag() const {return upper_diag;}
-    std::vector<double> get_lower_diag() const {return lower_diag;}
-    std::vector<double> get_rhs() const {return rhs;}
-    std::vector<double> get_p_mob() const {return p_mob;}
-    std::vector<double> get_B_p1() const {return B_p1;}
-    std::vector<double> get_B_p2() const {return B_p2;}
+    const std::vector<double> &get_main_diag() const {return main_diag;}
+    const std::vector<double> &get_upper_diag() const {return upper_diag;}
+    const std::vector<double> &get_lower_diag() const {return lower_diag;}
+    const std::vector<double> &get_rhs() const {return rhs;}
+    const std::vector<double> &get_p_mob() const {return p_mob;}
+    const std::vector<double> &get_B_p1() const {return B_p1;}
+    const std::vector<double> &get_B_p2() const {return B_p2;}
     double get_p_leftBC() const {return p_leftBC;}
     double get_p_rightBC() const {return p_rightBC;}
 
@@ -0,0 +1,134 @@
+#include "gaussian_process.h"
+
+#include <cmath>
+
+void Gaussian_process::fit(const std::vector<std::vector<double> > &points, const std::vector<double> &values, bool optimize_length)
+{
+    X = points;
+    const int n = static_cast<int>(values.size());
+
+    //normalize the values
+    y_mean = 0.0;
+    for (int i = 0; i < n; i++) y_mean += values[i];
+    y_mean /= n;
+    double var = 0.0;
+    for (int i = 0; i < n; i++) var += (values[i] - y_mean)*(values[i] - y_mean);
+    y_std = (n > 1 && var > 0.0) ? sqrt(var/(n-1)) : 1.0;
+    y.resize(n);
+    for (int i = 0; i < n; i++) y[i] = (values[i] - y_mean)/y_std;
+
+    const int dims = static_cast<int>(points[0].size());
+    if (static_cast<int>(length_scales.size()) != dims)
+        length_scales.assign(dims, 0.3);
+
+    if (optimize_length) {
+        //coordinate search over a range of length scales for each dimension (only few hyperparameters, so this is cheap enough)
+        const double lengths[] = {0.03, 0.05, 0.1, 0.15, 0.2, 0.3, 0.5, 0.8, 1.2, 2.0, 4.0};
+        double best_likelihood = factorize();
+        for (int sweep = 0; sweep < 2; sweep++) {
+            for (int dim = 0; dim < dims; dim++) {
+                double best_length = length_scales[dim];
+                for (double length : lengths) {
+                    length_scales[dim] = length;
+                    double likelihood = factorize();
+                    if (likelihood > best_likelihood) {
+                        best_likelihood = likelihood;
+                        best_length = length;
+                    }
+                }
+                length_scales[dim] = best_length;
+            }
+        }
+    }
+    factorize();
+}
+
+
+double Gaussian_process::kernel(const std::vector<double> &a, const std::vector<double> &b) const
+{
+    double dist2 = 0.0;
+    for (size_t k = 0; k < a.size(); k++) {
+        double d = (a[k] - b[k])/length_scales[k];
+        dist2 += d*d;
+    }
+    return exp(-0.5*dist2);
+}
+
+
+double Gaussian_process::factorize()
+{
+    const int n = static_cast<int>(y.size());
+    L.assign(n*n, 0.0);
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+            double sum = kernel(X[i], X[j]);
+            if (i == j) sum += noise;
+            for (int k = 0; k < j; k++) sum -= L[i*n + k]*L[j*n + k];
+            if (i == j) {
+                if (sum <= 0.0) return -1e300;   //not positive definite
+                L[i*n + i] = sqrt(sum);
+            } else {
+                L[i*n + j] = sum/L[j*n + j];
+            }
+        }
+    }
+
+    //alpha = L^T \ (L \ y)
+    alpha = y;
+    forward_solve(alpha);
+    double data_fit = 0.0;
+    for (int i = 0; i < n; i++) data_fit += alpha[i]*alpha[i];
+    for (int i = n-1; i >= 0; i--) {
+        for (int k = i+1; k < n; k++) alpha[i] -= L[k*n + i]*alpha[k];
+        alpha[i] /= L[i*n + i];
+    }
+
+    double log_det = 0.0;
+    for (int i = 0; i < n; i++) log_det += 2.0*log(L[i*n + i]);
+
+    return -0.5*data_fit - 0.5*log_det;
+}
+
+
+void Gaussian_process::forward_solve(std::vector<double> &b) const
+{
+    const int n = static_cast<int>(b.size());
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < i; k++) b[i] -= L[i*n + k]*b[k];
+        b[i] /= L[i*n + i];
+    }
+}
+
+
+void Gaussian_process::predict(const std::vector<double> &x, double &mean, double &std_dev) const
+{
+    const int n = static_cast<int>(y.size());
+    std::vector<double> k_star(n);
+    for (int i = 0; i < n; i++) k_star[i] = kernel(x, X[i]);
+
+    double mu = 0.0;
+    for (int i = 0; i < n; i++) mu += k_star[i]*alpha[i];
+
+    forward_solve(k_star);  //v = L \ k_star, variance = k(x,x) - v.v
+    double var = 1.0 + noise;
+    for (int i = 0; i < n; i++) var -= k_star[i]*k_star[i];
+    if (var < 1e-12) var = 1e-12;
+
+    mean = y_mean + y_std*mu;
+    std_dev = y_std*sqrt(var);
+}
+
+
+double Gaussian_process::expected_improvement(const std::vector<double> &x, double best_value) const
+{
+    double mean, std_dev;
+    predict(x, mean, std_dev);
+
+    double improvement = best_value - mean;
+    double z = improvement/std_dev;
+    double cdf = 0.5*erfc(-z/sqrt(2.0));
+    double pdf = exp(-0.5*z*z)/sqrt(2.0*3.14159265358979323846);
+
+    return improvement*cdf + std_dev*pdf;
+}
@@ -0,0 +1,46 @@
+#ifndef GAUSSIAN_PROCESS_H
+#define GAUSSIAN_PROCESS_H
+
+#include <vector>
+
+//!Gaussian process regression model, used as a cheap surrogate of the cost function for the fitting.
+//! Uses a squared exponential kernel with a separate length scale for each dimension (points scaled to [0,1]^d), since the
+//! cost is usually much more sensitive to some variables than to others. The values are normalized to zero mean and unit variance.
+class Gaussian_process
+{
+public:
+    Gaussian_process() : noise(1e-6), y_mean(0.0), y_std(1.0) {}
+
+    //!Fits the model to the points \param points and values \param values. If \param optimize_length is true, the kernel
+    //! length scales are chosen by maximizing the marginal likelihood, otherwise the previous length scales are kept.
+    void fit(const std::vector<std::vector<double> > &points, const std::vector<double> &values, bool optimize_length = true);
+
+    //!Predicts the \param mean and standard deviation \param std_dev of the value at point \param x
+    void predict(const std::vector<double> &x, double &mean, double &std_dev) const;
+
+    //!Expected improvement (for minimization) over the best value \param best_value at point \param x
+    double expected_improvement(const std::vector<double> &x, double best_value) const;
+
+    const std::vector<double> &get_length_scales() const {return length_scales;}
+
+private:
+    std::vector<double> length_scales;
+    double noise;    //added to the diagonal of the kernel matrix, for stability
+    double y_mean, y_std;
+
+    std::vector<std::vector<double> > X;
+    std::vector<double> y;      //normalized values
+    std::vector<double> L;      //Cholesky factor of the kernel matrix (lower triangular, row major)
+    std::vector<double> alpha;  //K^-1 * y
+
+    double kernel(const std::vector<double> &a, const std::vector<double> &b) const;
+
+    //!Builds and factorizes the kernel matrix with the current length scales. Returns the log marginal likelihood,
+    //! or a very negative value if the matrix is not positive definite.
+    double factorize();
+
+    //!Solves L*x = \param b in place
+    void forward_solve(std::vector<double> &b) const;
+};
+
+#endif // GAUSSIAN_PROCESS_H
@@ -36,6 +36,8 @@
 #include "run_DD.h"
 #include "parameters.h"
 #include "optimization.h"
+#include "batch.h"
+#include "trace.h"
 
 int main()
 {
@@ -43,9 +45,14 @@ int main()
 
     Parameters params;    //params is struct storing all parameters
     params.Initialize();  //reads parameters from file (will set the starting parameter set for PSO)
+    if (params.trace_file != "none")
+        Trace::start(params.trace_buffer_size);
 
 
-    if (params.auto_fit == true) {
+    if (params.batch_mode()) {
+        Batch_runner batch(params);
+        batch.run();
+    } else if (params.auto_fit == true) {
 
         if (params.optim_method == 1) {
             Optim::Gradient_Descent GD(params);
@@ -53,6 +60,12 @@ int main()
         } else if (params.optim_method ==2) {
             Optim::Particle_swarm PSO(params);  //creating an object of Particle_swarm struct which is member of Optimization class
             PSO.run_PSO();
+        } else if (params.optim_method == 3) {
+            Optim::Surrogate surrogate(params);
+            surrogate.run_surrogate();
+        } else if (params.optim_method == 4) {
+            Optim::Levenberg_Marquardt LM(params);
+            LM.run_LM();
         } else {
             std::cout << "Invalid optimization method" << std::endl;
             exit(1);
@@ -62,6 +75,9 @@ int main()
         run_DD(params);  //run once
     }
 
+    if (Trace::enabled())
+        Trace::write(params.trace_file);
+
     std::chrono::high_resolution_clock::time_point finish = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> time = std::chrono::duration_cast<std::chrono::duration<double>>(finish-start);
     std::cout << "Total CPU time = " << time.count() << std::endl;
@@ -0,0 +1,111 @@
+#include "multi_fidelity.h"
+
+#include <algorithm>
+
+Multi_fidelity::Multi_fidelity(const Parameters &params, const std::vector<double> &gen_rate, const std::vector<double> &J_exp, Solution_cache *cache)
+    : mesh_factor(params.MF_mesh_factor), Va_stride(params.MF_Va_stride), gen_rate(gen_rate), J_exp(J_exp),
+      vars_min(params.vars_min), vars_max(params.vars_max), cache(cache), coarse_runs(0), full_runs(0)
+{
+    //the coarse mesh nodes are every mesh_factor'th node of the full mesh, so the generation rate is just sampled there
+    const int coarse_num_cell = params.num_cell/mesh_factor;
+    coarse_gen_rate.resize(coarse_num_cell);
+    for (int i = 1; i <= coarse_num_cell-1; i++)
+        coarse_gen_rate[i] = gen_rate[i*mesh_factor];
+
+    //Photogeneration scales the profile by its max, which can be missed by the coarse mesh
+    double max_full = *std::max_element(gen_rate.begin(), gen_rate.end());
+    double max_coarse = *std::max_element(coarse_gen_rate.begin(), coarse_gen_rate.end());
+    gen_rate_max_ratio = max_coarse/max_full;
+
+    for (size_t i = 0; i < J_exp.size(); i += Va_stride)
+        coarse_J_exp.push_back(J_exp[i]);
+
+    if (params.warm_start_cache_size > 0)
+        coarse_cache.reset(new Solution_cache(params, params.warm_start_cache_size));
+}
+
+
+Parameters Multi_fidelity::coarsen(const Parameters &params) const
+{
+    Parameters coarse = params;
+    coarse.num_cell = params.num_cell/mesh_factor;
+    coarse.dx = params.dx*mesh_factor;
+    coarse.increment = params.increment*Va_stride;
+    coarse.Photogen_scaling = params.Photogen_scaling*gen_rate_max_ratio;  //so the generation rate is the same at the coarse nodes
+
+    return coarse;
+}
+
+
+std::vector<double> Multi_fidelity::key(const Parameters &params) const
+{
+    return normalized_var_values(params, vars_min, vars_max);
+}
+
+
+Multi_fidelity::Evaluation Multi_fidelity::evaluate(const Parameters &params, double max_cost, double promote_cost)
+{
+    Evaluation evaluation;
+    std::vector<double> params_key = key(params);
+
+    //correct the coarse curve by the difference at the nearest promoted parameter set. Instead of adding it to the coarse
+    //current, it's subtracted from the experimental curve, so solve_DD can still stop the run early
+    std::vector<double> target = coarse_J_exp;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const Correction *nearest = nullptr;
+        double min_dist = 1e300;
+        for (size_t c = 0; c < corrections.size(); c++) {
+            double dist = 0.0;
+            for (size_t i = 0; i < params_key.size(); i++)
+                dist += (params_key[i] - corrections[c].key[i])*(params_key[i] - corrections[c].key[i]);
+            if (dist < min_dist) {
+                min_dist = dist;
+                nearest = &corrections[c];
+            }
+        }
+        if (nearest) {
+            for (size_t k = 0; k < target.size() && k < nearest->delta.size(); k++)
+                target[k] -= nearest->delta[k];
+        }
+    }
+
+    //the coarse cost is scaled by Va_stride, so it estimates the sum over all voltages
+    DD_options options;
+    options.gen_rate = &coarse_gen_rate;
+    options.J_exp = &target;
+    options.max_cost = promote_cost/Va_stride;
+    DD_result coarse = solve_DD_cached(coarsen(params), options, coarse_cache.get());
+    coarse_runs++;
+
+    evaluation.cost = Va_stride*coarse.cost;
+    evaluation.full = false;
+    evaluation.aborted = true;
+    if (coarse.aborted || evaluation.cost > promote_cost)
+        return evaluation;
+
+    //promising, so run at full resolution
+    options.gen_rate = &gen_rate;
+    options.J_exp = &J_exp;
+    options.max_cost = max_cost;
+    DD_result full = solve_DD_cached(params, options, cache);
+    full_runs++;
+
+    evaluation.cost = full.cost;
+    evaluation.full = true;
+    evaluation.aborted = full.aborted;
+    if (full.aborted)
+        return evaluation;   //the full curve is incomplete
+
+    Correction correction;
+    correction.key = params_key;
+    for (size_t k = 0; k < coarse.J.size() && k*Va_stride < full.J.size(); k++)
+        correction.delta.push_back(full.J[k*Va_stride] - coarse.J[k]);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    corrections.push_back(correction);
+    while (static_cast<int>(corrections.size()) > max_corrections)
+        corrections.pop_front();
+
+    return evaluation;
+}
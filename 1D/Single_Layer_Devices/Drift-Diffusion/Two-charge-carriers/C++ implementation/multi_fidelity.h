@@ -0,0 +1,71 @@
+#ifndef MULTI_FIDELITY_H
+#define MULTI_FIDELITY_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include "parameters.h"
+#include "run_DD.h"
+#include "solution_cache.h"
+
+//!Multi-fidelity evaluation of the fitting cost, for the optimizers. A candidate parameter set is first run at a coarse level:
+//! the mesh has num_cell/MF_mesh_factor cells and only every MF_Va_stride'th voltage is done, which is about
+//! MF_mesh_factor*MF_Va_stride times cheaper than a full run. Only candidates with a promising coarse cost are promoted,
+//! i.e. run again at full resolution, so all costs which can become a best are full resolution costs.
+//! Correction model: the difference between the full and coarse JV curves, found at each promoted parameter set, is added to
+//! the coarse curve of later candidates (using the nearest promoted parameter set). This removes most of the discretization error
+//! of the coarse level, which changes slowly with the parameters. Thread safe.
+class Multi_fidelity
+{
+public:
+    //!\param params gives the levels (MF_mesh_factor, MF_Va_stride) and the ranges of the fitting variables. \param gen_rate is the
+    //! full resolution generation rate profile and \param J_exp the experimental JV curve. \param cache (can be null) is used for
+    //! warm starting the full resolution runs, the coarse runs get their own cache of the same size.
+    Multi_fidelity(const Parameters &params, const std::vector<double> &gen_rate, const std::vector<double> &J_exp, Solution_cache *cache);
+
+    struct Evaluation
+    {
+        double cost;    //least squares difference to J_exp (estimated from the coarse run, if not promoted)
+        bool full;      //true if the candidate was promoted and run at full resolution
+        bool aborted;   //true if the cost is only known to be > the max_cost (or > promote_cost, if not promoted)
+    };
+
+    //!Finds the cost for \param params. The coarse run stops once the (corrected) cost is > \param promote_cost, and the candidate
+    //! is run at full resolution only if it's below. The full resolution run stops once the cost is > \param max_cost.
+    Evaluation evaluate(const Parameters &params, double max_cost, double promote_cost);
+
+    int get_coarse_runs() const {return coarse_runs;}
+    int get_full_runs() const {return full_runs;}
+
+private:
+    int mesh_factor, Va_stride;
+    double gen_rate_max_ratio;   //max of the coarse generation rate profile / max of the full one
+    std::vector<double> gen_rate, coarse_gen_rate;
+    std::vector<double> J_exp, coarse_J_exp;
+    std::vector<double> vars_min, vars_max;
+
+    Solution_cache *cache;
+    std::unique_ptr<Solution_cache> coarse_cache;
+
+    struct Correction
+    {
+        std::vector<double> key;
+        std::vector<double> delta;   //full - coarse current at each coarse voltage
+    };
+    static const int max_corrections = 200;
+    std::deque<Correction> corrections;
+    mutable std::mutex mutex;
+
+    std::atomic<int> coarse_runs, full_runs;
+
+    //!Returns the coarse level parameters for the full resolution \param params
+    Parameters coarsen(const Parameters &params) const;
+
+    //!Returns the fitting variables of \param params, normalized to [0,1] (logarithmically for positive ranges)
+    std::vector<double> key(const Parameters &params) const;
+};
+
+#endif // MULTI_FIDELITY_H
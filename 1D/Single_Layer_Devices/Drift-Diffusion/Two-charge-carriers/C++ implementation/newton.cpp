@@ -0,0 +1,267 @@
+#include "newton.h"
+#include "block_tridiag_solve.h"
+
+#include <cmath>
+#include <algorithm>
+
+Newton::Newton(const Parameters &params)
+{
+    num_cell = params.num_cell;
+    max_iter = 100;
+    max_dV = 1.0;
+
+    CV = params.N*params.dx*params.dx*q/(epsilon_0*Vt);     //same as in Poisson
+    Cn = params.dx*params.dx/(Vt*params.N*params.mobil);    //same as in Continuity_n
+    Cp = Cn;
+    kN2 = params.k_rec*params.N*params.N;
+    error = 1.0;
+
+    //blocks and vectors are indexed from 1 to num_cell-1 (interior mesh points), same as for the Thomas solver
+    jac_lower.resize(9*num_cell);
+    jac_diag.resize(9*num_cell);
+    jac_upper.resize(9*num_cell);
+    residual.resize(3*num_cell);
+    delta.resize(3*num_cell);
+    Un.resize(num_cell);
+}
+
+
+int Newton::solve(const Parameters &params, Poisson &poisson, Continuity_n &continuity_n, Continuity_p &continuity_p, Recombo &recombo,
+                  const std::vector<double> &PhotogenRate, double V_leftBC, double V_rightBC,
+                  std::vector<double> &V, std::vector<double> &n, std::vector<double> &p)
+{
+    const int num_blocks = num_cell-1;
+
+    V_start = V;
+    n_start = n;
+    p_start = p;
+    V[0] = V_leftBC;
+    V[num_cell] = V_rightBC;
+
+    for (int iter = 1; iter <= max_iter; iter++) {
+
+        setup_system(poisson, continuity_n, continuity_p, recombo, params, PhotogenRate, V_leftBC, V_rightBC, V, n, p);
+
+        if (!Block_Thomas_solve(jac_lower, jac_diag, jac_upper, residual, delta, num_blocks))
+            break;
+
+        //damp the step if the potential changes by too much (keeps the Bernoulli fnc.'s and densities well behaved far from the solution)
+        double dV_max = 0.0;
+        for (int i = 1; i <= num_blocks; i++)
+            dV_max = std::max(dV_max, std::abs(delta[3*i]));
+        if (!std::isfinite(dV_max))
+            break;
+        double damping = (dV_max > max_dV) ? max_dV/dV_max : 1.0;
+
+        //update the solution and calculate the error the same way as for Gummel iterations
+        double error_np = 0.0;
+        for (int i = 1; i <= num_blocks; i++) {
+            double dn = damping*delta[3*i+1];
+            double dp = damping*delta[3*i+2];
+            error_np = std::max(error_np, (std::abs(dn) + std::abs(dp))/std::abs(n[i] + p[i]));
+
+            V[i] += damping*delta[3*i];
+            n[i] = (n[i] + dn > 0.0) ? n[i] + dn : 0.1*n[i];  //keep the densities positive
+            p[i] = (p[i] + dp > 0.0) ? p[i] + dp : 0.1*p[i];
+        }
+        error = error_np;
+        if (!std::isfinite(error_np))
+            break;
+
+        if (damping == 1.0 && error_np <= params.tolerance && dV_max <= params.tolerance) {
+            //update the Bernoulli fnc.'s to the final V, since they are used for calculating currents
+            const std::vector<double> &R_Langevin = recombo.ComputeR_Langevin(params, n, p);
+            for (int i = 1; i < num_cell; i++)
+                Un[i] = PhotogenRate[i] - R_Langevin[i];
+            continuity_n.setup_eqn(V, Un);
+            continuity_p.setup_eqn(V, Un);
+
+            return iter;
+        }
+    }
+
+    //did not converge: restore the initial guess
+    V = V_start;
+    n = n_start;
+    p = p_start;
+
+    return -1;
+}
+
+
+void Newton::setup_system(Poisson &poisson, Continuity_n &continuity_n, Continuity_p &continuity_p, Recombo &recombo, const Parameters &params,
+                          const std::vector<double> &PhotogenRate, double V_leftBC, double V_rightBC,
+                          const std::vector<double> &V, const std::vector<double> &n, const std::vector<double> &p)
+{
+    const int num_blocks = num_cell-1;
+
+    //Recombination and the Scharfetter-Gummel matrices at the current solution
+    const std::vector<double> &R_Langevin = recombo.ComputeR_Langevin(params, n, p);
+    for (int i = 1; i < num_cell; i++)
+        Un[i] = PhotogenRate[i] - R_Langevin[i];
+
+    poisson.set_rhs(n, p, V_leftBC, V_rightBC);
+    continuity_n.setup_eqn(V, Un);
+    continuity_p.setup_eqn(V, Un);
+
+    const std::vector<double> &a_V = poisson.get_main_diag(), &b_V = poisson.get_upper_diag(), &c_V = poisson.get_lower_diag(), &rhs_V = poisson.get_rhs();
+    const std::vector<double> &a_n = continuity_n.get_main_diag(), &b_n = continuity_n.get_upper_diag(), &c_n = continuity_n.get_lower_diag(), &rhs_n = continuity_n.get_rhs();
+    const std::vector<double> &a_p = continuity_p.get_main_diag(), &b_p = continuity_p.get_upper_diag(), &c_p = continuity_p.get_lower_diag(), &rhs_p = continuity_p.get_rhs();
+    const std::vector<double> &n_mob = continuity_n.get_n_mob(), &B_n1 = continuity_n.get_B_n1(), &B_n2 = continuity_n.get_B_n2();
+    const std::vector<double> &p_mob = continuity_p.get_p_mob(), &B_p1 = continuity_p.get_B_p1(), &B_p2 = continuity_p.get_B_p2();
+    const double n_rightBC = continuity_n.get_n_rightBC();
+    const double p_rightBC = continuity_p.get_p_rightBC();
+
+    std::fill(jac_lower.begin(), jac_lower.end(), 0.0);
+    std::fill(jac_diag.begin(), jac_diag.end(), 0.0);
+    std::fill(jac_upper.begin(), jac_upper.end(), 0.0);
+
+    //derivatives of the electron and hole fluxes at cell face j (between mesh points j-1 and j) wrt. dV_j = V[j]-V[j-1]
+    //flux_n(j) = n_mob[j]*(n[j]*B(dV_j) - n[j-1]*B(-dV_j)),   flux_p(j) = p_mob[j]*(p[j-1]*B(dV_j) - p[j]*B(-dV_j))
+    double dflux_n_left, dflux_p_left, dflux_n_right, dflux_p_right;
+    double dV = V[1] - V[0];
+    dflux_n_left = n_mob[1]*(n[1]*dBernoulli(dV, B_n1[1], B_n2[1]) + n[0]*dBernoulli(-dV, B_n2[1], B_n1[1]));
+    dflux_p_left = p_mob[1]*(p[0]*dBernoulli(dV, B_p1[1], B_p2[1]) + p[1]*dBernoulli(-dV, B_p2[1], B_p1[1]));
+
+    for (int i = 1; i <= num_blocks; i++) {
+        double n_next = (i < num_blocks) ? n[i+1] : n_rightBC;
+        double p_next = (i < num_blocks) ? p[i+1] : p_rightBC;
+        dV = V[i+1] - V[i];
+        dflux_n_right = n_mob[i+1]*(n_next*dBernoulli(dV, B_n1[i+1], B_n2[i+1]) + n[i]*dBernoulli(-dV, B_n2[i+1], B_n1[i+1]));
+        dflux_p_right = p_mob[i+1]*(p[i]*dBernoulli(dV, B_p1[i+1], B_p2[i+1]) + p_next*dBernoulli(-dV, B_p2[i+1], B_p1[i+1]));
+
+        //Residuals: F = A*x - rhs for each of the 3 equations (BC's are already included in the rhs's)
+        double F_V = a_V[i]*V[i] - rhs_V[i];
+        double F_n = a_n[i]*n[i] - rhs_n[i];
+        double F_p = a_p[i]*p[i] - rhs_p[i];
+        if (i > 1) {
+            F_V += c_V[i-1]*V[i-1];
+            F_n += c_n[i-1]*n[i-1];
+            F_p += c_p[i-1]*p[i-1];
+        }
+        if (i < num_blocks) {
+            F_V += b_V[i]*V[i+1];
+            F_n += b_n[i]*n[i+1];
+            F_p += b_p[i]*p[i+1];
+        }
+        residual[3*i] = -F_V;
+        residual[3*i+1] = -F_n;
+        residual[3*i+2] = -F_p;
+
+        //derivatives of the recombination rate (is 0 where R_Langevin was clamped to 0)
+        double dR_dn = (R_Langevin[i] > 0.0) ? kN2*p[i] : 0.0;
+        double dR_dp = (R_Langevin[i] > 0.0) ? kN2*n[i] : 0.0;
+
+        //Block rows: 0 = Poisson, 1 = electron continuity, 2 = hole continuity. Columns: 0 = V, 1 = n, 2 = p
+        double *D = &jac_diag[9*i];
+        D[0] = a_V[i];
+        D[1] = -CV;
+        D[2] = CV;
+        D[3] = -dflux_n_right - dflux_n_left;
+        D[4] = a_n[i] - Cn*dR_dn;
+        D[5] = -Cn*dR_dp;
+        D[6] = dflux_p_left + dflux_p_right;
+        D[7] = -Cp*dR_dn;
+        D[8] = a_p[i] - Cp*dR_dp;
+
+        if (i > 1) {
+            double *L = &jac_lower[9*i];
+            L[0] = c_V[i-1];
+            L[3] = dflux_n_left;
+            L[4] = c_n[i-1];
+            L[6] = -dflux_p_left;
+            L[8] = c_p[i-1];
+        }
+        if (i < num_blocks) {
+            double *U = &jac_upper[9*i];
+            U[0] = b_V[i];
+            U[3] = dflux_n_right;
+            U[4] = b_n[i];
+            U[6] = -dflux_p_right;
+            U[8] = b_p[i];
+        }
+
+        dflux_n_left = dflux_n_right;
+        dflux_p_left = dflux_p_right;
+    }
+}
+
+
+bool Newton::sensitivities(const Parameters &params, Poisson &poisson, Continuity_n &continuity_n, Continuity_p &continuity_p, Recombo &recombo,
+                           const std::vector<double> &PhotogenRate, double V_leftBC, double V_rightBC,
+                           const std::vector<double> &V, const std::vector<double> &n, const std::vector<double> &p,
+                           int J_index, std::vector<double> &dJ)
+{
+    const int num_blocks = num_cell-1;
+    const int num_vars = 4;
+    dJ.assign(num_vars, 0.0);
+
+    //Jacobian and residual at the solution (this also sets Un and the Bernoulli fnc.'s for the solution)
+    setup_system(poisson, continuity_n, continuity_p, recombo, params, PhotogenRate, V_leftBC, V_rightBC, V, n, p);
+
+    //the current at J_index and its derivatives wrt. the unknowns (same expressions as in run_DD)
+    const int m = J_index;
+    const double J_coeff = q*Vt*params.N*params.mobil/params.dx;
+    const std::vector<double> &n_mob = continuity_n.get_n_mob(), &B_n1 = continuity_n.get_B_n1(), &B_n2 = continuity_n.get_B_n2();
+    const std::vector<double> &p_mob = continuity_p.get_p_mob(), &B_p1 = continuity_p.get_B_p1(), &B_p2 = continuity_p.get_B_p2();
+    const double dV = V[m] - V[m-1];
+    const double Jn = J_coeff*n_mob[m]*(n[m]*B_n1[m] - n[m-1]*B_n2[m]);
+    const double Jp = -J_coeff*p_mob[m]*(p[m]*B_p2[m] - p[m-1]*B_p1[m]);
+    const double dJ_ddV = J_coeff*n_mob[m]*(n[m]*dBernoulli(dV, B_n1[m], B_n2[m]) + n[m-1]*dBernoulli(-dV, B_n2[m], B_n1[m]))
+                        + J_coeff*p_mob[m]*(p[m-1]*dBernoulli(dV, B_p1[m], B_p2[m]) + p[m]*dBernoulli(-dV, B_p2[m], B_p1[m]));
+
+    //derivatives of the residuals wrt. each variable. Only the continuity eqns depend on them:
+    //F_n = (SG flux terms, proportional to n_mob) + Cn*Un, and Un = G - R with G proportional to Photogen_scaling and R to k_rec
+    const double Photogen_scaling = params.Photogen_scaling, n_mob_active = params.n_mob_active, p_mob_active = params.p_mob_active, k_rec = params.k_rec;
+    std::vector<double> &rhs = residual;   //residual isn't needed after this
+    std::vector<double> F_n(num_cell), F_p(num_cell);
+    for (int i = 1; i <= num_blocks; i++) {
+        F_n[i] = -residual[3*i+1];
+        F_p[i] = -residual[3*i+2];
+    }
+
+    for (int var = 0; var < num_vars; var++) {
+        for (int i = 1; i <= num_blocks; i++) {
+            double R = PhotogenRate[i] - Un[i];
+            double dF_n = 0.0, dF_p = 0.0;
+            if (var == 0) {
+                dF_n = Cn*PhotogenRate[i]/Photogen_scaling;
+                dF_p = Cp*PhotogenRate[i]/Photogen_scaling;
+            } else if (var == 1) {
+                dF_n = (F_n[i] - Cn*Un[i])/n_mob_active;
+            } else if (var == 2) {
+                dF_p = (F_p[i] - Cp*Un[i])/p_mob_active;
+            } else {
+                dF_n = -Cn*R/k_rec;
+                dF_p = -Cp*R/k_rec;
+            }
+            rhs[3*i] = 0.0;
+            rhs[3*i+1] = -dF_n;
+            rhs[3*i+2] = -dF_p;
+        }
+
+        diag_copy = jac_diag;
+        if (!Block_Thomas_solve(jac_lower, diag_copy, jac_upper, rhs, delta, num_blocks)) {
+            dJ.assign(num_vars, 0.0);
+            return false;
+        }
+
+        //BC's are fixed, so only the interior points change
+        delta[0] = delta[1] = delta[2] = 0.0;
+        dJ[var] = dJ_ddV*(delta[3*m] - delta[3*(m-1)])
+                + J_coeff*n_mob[m]*(B_n1[m]*delta[3*m+1] - B_n2[m]*delta[3*(m-1)+1])
+                - J_coeff*p_mob[m]*(B_p2[m]*delta[3*m+2] - B_p1[m]*delta[3*(m-1)+2]);
+        if (var == 1) dJ[var] += Jn/n_mob_active;   //explicit dependence: the currents are proportional to the mobilities
+        if (var == 2) dJ[var] += Jp/p_mob_active;
+    }
+    return true;
+}
+
+
+double Newton::dBernoulli(double x, double B_pos, double B_neg) const
+{
+    if (std::abs(x) < 1e-5)
+        return -0.5 + x/6.;   //series expansion, to prevent blowup due to 0 denominator
+
+    return B_pos*(1.0 - B_neg)/x;
+}
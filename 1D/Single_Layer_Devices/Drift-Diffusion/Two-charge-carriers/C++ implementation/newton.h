@@ -0,0 +1,66 @@
+#ifndef NEWTON_H
+#define NEWTON_H
+
+#include <vector>
+#include "parameters.h"
+#include "constants.h"
+#include "poisson.h"
+#include "continuity_n.h"
+#include "continuity_p.h"
+#include "recombination.h"
+
+class Newton
+{
+public:
+    Newton(const Parameters &params);
+
+    //!Solves the Poisson and both continuity equations together (fully coupled Newton-Raphson method) at one applied voltage.
+    //! The unknowns at each mesh point are (V, n, p), so the Jacobian is a block tridiagonal matrix with 3x3 blocks.
+    //! The n-n and p-p blocks are the Scharfetter-Gummel matrices set up by \param continuity_n and \param continuity_p,
+    //! and the derivatives wrt. V are found analytically from the Bernoulli functions.
+    //! \param V, \param n, \param p are the initial guess (usually the solution at the previous voltage) and are overwritten with the solution.
+    //! Returns the number of Newton iterations, or -1 if it did not converge (then V, n, p are restored to the initial guess).
+    int solve(const Parameters &params, Poisson &poisson, Continuity_n &continuity_n, Continuity_p &continuity_p, Recombo &recombo,
+              const std::vector<double> &PhotogenRate, double V_leftBC, double V_rightBC,
+              std::vector<double> &V, std::vector<double> &n, std::vector<double> &p);
+
+    //!error_np (relative change of n and p, as for Gummel iterations) of the last Newton iteration of solve
+    double get_error() const {return error;}
+
+    //!Forward sensitivity analysis at a converged solution \param V, \param n, \param p: finds the derivatives of the current J_total at
+    //! mesh point \param J_index wrt. the fitting variables (Photogen_scaling, n_mob_active, p_mob_active, k_rec, same order as Parameters::vars).
+    //! For each variable, the linearized system Jacobian*dx = -dF/dvar is solved (same block tridiagonal Jacobian as for the Newton steps),
+    //! and dJ = dJ/dx*dx + the explicit dependence of J. The derivatives are written to \param dJ.
+    //! Returns false if the linearized system couldn't be solved (then dJ is 0 and should not be used).
+    bool sensitivities(const Parameters &params, Poisson &poisson, Continuity_n &continuity_n, Continuity_p &continuity_p, Recombo &recombo,
+                       const std::vector<double> &PhotogenRate, double V_leftBC, double V_rightBC,
+                       const std::vector<double> &V, const std::vector<double> &n, const std::vector<double> &p,
+                       int J_index, std::vector<double> &dJ);
+
+private:
+    int num_cell;
+    int max_iter;      //!max # of Newton iterations before giving up (then Gummel is used instead)
+    double max_dV;     //!updates of V larger than this (in units of Vt) are damped
+    double CV, Cn, Cp;
+    double kN2;        //!k_rec*N^2, for the derivative of the recombination rate
+    double error;      //!error_np of the last Newton iteration
+
+    std::vector<double> jac_lower;  //3x3 blocks of the Jacobian
+    std::vector<double> jac_diag;
+    std::vector<double> jac_upper;
+    std::vector<double> residual;   //stores -F, the rhs of the Newton step equation
+    std::vector<double> delta;      //the Newton step (dV, dn, dp) at each mesh point
+    std::vector<double> Un;
+    std::vector<double> V_start, n_start, p_start;  //initial guess, to restore if Newton fails
+    std::vector<double> diag_copy;  //for the sensitivity solves, since the block Thomas solver overwrites the diagonal blocks
+
+    //!Sets up the residual and the Jacobian at the current (V, n, p)
+    void setup_system(Poisson &poisson, Continuity_n &continuity_n, Continuity_p &continuity_p, Recombo &recombo, const Parameters &params,
+                      const std::vector<double> &PhotogenRate, double V_leftBC, double V_rightBC,
+                      const std::vector<double> &V, const std::vector<double> &n, const std::vector<double> &p);
+
+    //!Derivative of the Bernoulli function B(x) = x/(exp(x)-1), using the already computed \param B_pos = B(x) and \param B_neg = B(-x)
+    double dBernoulli(double x, double B_pos, double B_neg) const;
+};
+
+#endif // NEWTON_H
@@ -1,4 +1,5 @@
 #include "optimization.h"
+#include "trace.h"
 #include <random>
 
 
@@ -15,9 +16,17 @@ Optim::Gradient_Descent::Gradient_Descent(Parameters &params): Params(params)  /
     overshoot = false;  //this becomes true when have overshot a local min--> needed to properly go back to the min
 
     best_lsqr_diff = 1e200;  //very large number to start
+    lsqr_diff = 1e200;
+    old_lsqr_diff = 1e200;
+    cost_fnc_cnt = 0;
+    generator.seed(static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count()));
 
     best_vars.resize(Params.vars.size());
 
+    gen_rate = Photogeneration::read_gen_rate(Params, Params.GenRateFileName);
+    if (Params.warm_start_cache_size > 0)
+        cache.reset(new Solution_cache(Params, Params.warm_start_cache_size));
+
     //prepare for optimization:
     //read in experimental curve into vectors--> since it never changes, just do once
 
@@ -34,24 +43,40 @@ Optim::Gradient_Descent::Gradient_Descent(Parameters &params): Params(params)  /
         J_vector_exp.push_back(temp_J);
     }
 
+    if (Params.use_multi_fidelity())
+        multi_fidelity.reset(new Multi_fidelity(Params, gen_rate, J_vector_exp, cache.get()));
+
+    num_searches = 0;
+    start_run = 1;
+    start_repeat = 1;
+    start_var = 0;
+    resumed = Params.resume && load_checkpoint();
+    if (Params.checkpoint_interval > 0)
+        checkpoint_writer.reset(new Checkpoint_writer(Params.checkpoint_file));
 }
 
 void Optim::Gradient_Descent::run_GD()
 {
-    int cost_fnc_cnt = 0;  //counter to count # of cost function calls (# of times DD model is run)
-
-    for (int GD_runs = 1; GD_runs < num_restarts; GD_runs++) {
+    for (int GD_runs = start_run; GD_runs < num_restarts; GD_runs++) {
 
         //choose starting value randomly (need restarts to ensure that are not stuck in a local min)
         //MAKE choice of the random value, OUTSIDE of the other loop over variables, so that all 4 values are chosen randomly, within the bounds
         //then is a fair test, not using my default values in the parameters file!
-        for (int var_index = 0; var_index < Params.vars.size(); var_index++)
-            *Params.vars[var_index] = rand_num(Params.vars_min[var_index], Params.vars_max[var_index]);
+        if (!resumed) {  //a resumed run continues with the values from the checkpoint
+            for (int var_index = 0; var_index < Params.vars.size(); var_index++)
+                *Params.vars[var_index] = rand_num(Params.vars_min[var_index], Params.vars_max[var_index]);
+        }
 
         //TRY: do this going over the variables twice!: the 1st time are using the random values from above, and the 2nd time are using the already, better found values,
-        for (int repeat = 1; repeat <= 2; repeat++) {
+        for (int repeat = resumed ? start_repeat : 1; repeat <= 2; repeat++) {
 
-            for (int var_index = 0; var_index < Params.vars.size(); var_index++) {   //for each variable that are optimizing
+            for (int var_index = resumed ? start_var : 0; var_index < Params.vars.size(); var_index++) {   //for each variable that are optimizing
+
+                if (resumed)
+                    resumed = false;
+                else if (checkpoint_writer && num_searches % Params.checkpoint_interval == 0)
+                    save_checkpoint(GD_runs, repeat, var_index);
+                num_searches++;
 
                 //reset iter counts
                 iter = 1;
@@ -81,7 +106,9 @@ void Optim::Gradient_Descent::run_GD()
                     *Params.vars[var_index] = std::max(*Params.vars[var_index], Params.vars_min[var_index]); //if particle position is lower than VarMin, then the position becomes VarMin
                     *Params.vars[var_index] = std::min(*Params.vars[var_index], Params.vars_max[var_index]);
 
-                    lsqr_diff = cost_function();  //this RUNS the DD simulation and computes the lsqr_diff
+                    //this RUNS the DD simulation and computes the lsqr_diff. After the direction is known (inner_iter > 2), only need to
+                    //know whether the cost is lower than old_lsqr_diff, so the run is stopped once it's higher
+                    lsqr_diff = cost_function((inner_iter > 2) ? old_lsqr_diff : 1e300);
                     cost_fnc_cnt++;
 
                     //for test:
@@ -216,7 +243,12 @@ void Optim::Gradient_Descent::run_GD()
 
 
         std::cout << "cost function count " << cost_fnc_cnt << std::endl;
+        if (multi_fidelity)
+            std::cout << "full resolution runs " << multi_fidelity->get_full_runs() << ", coarse runs " << multi_fidelity->get_coarse_runs() << std::endl;
     }
+    if (checkpoint_writer)
+        save_checkpoint(num_restarts, 1, 0);  //so resuming a finished fit only prints the summary
+
     std::cout << "Run Summary: " << std::endl;
     std::cout << "Best Cost: " << best_lsqr_diff << std::endl;
     std::cout << "Current best parameter values are " << std::endl;
@@ -227,13 +259,15 @@ void Optim::Gradient_Descent::run_GD()
 }
 
 //Particle struct constructor
-Optim::Particle_swarm::Particle::Particle(int n_vars, Parameters &params)
+Optim::Particle_swarm::Particle::Particle(int n_vars, const Parameters &params, unsigned seed) : generator(seed)
 {
     particle_params = params;   //make particle's parameters = to overall params. NOTE: this makes a copy,
     velocity.resize(n_vars);
     position.resize(n_vars);
     best_position.resize(n_vars);
     particle_vars.resize(n_vars);
+    cost = 1e200;
+    best_cost = 1e200;   //so the 1st run is never stopped early
 
     //============================================================================================
     //initialize the POINTERS to particle_params for the vars that will need changing
@@ -279,6 +313,24 @@ Optim::Particle_swarm::Particle_swarm(Parameters &params) : Params(params)  //NO
 
     n_vars = Params.vars.size();   //number of variables that are adjusting
 
+    gen_rate = Photogeneration::read_gen_rate(Params, Params.GenRateFileName);
+    if (Params.warm_start_cache_size > 0)
+        cache.reset(new Solution_cache(Params, Params.warm_start_cache_size));
+    if (Params.use_multi_fidelity())
+        multi_fidelity.reset(new Multi_fidelity(Params, gen_rate, J_vector_exp, cache.get()));
+    coarse_stage = coarse_iteration(0);  //the initial evaluation counts as the 1st iteration
+
+    //no use in having more threads than particles
+    int num_threads = (Params.num_threads > 0) ? Params.num_threads : Thread_pool::hardware_threads();
+    thread_pool.reset(new Thread_pool(std::min(num_threads, n_particles)));
+    std::cout << "Evaluating particles on " << thread_pool->size() << " threads" << std::endl;
+
+    //each particle gets its own random number stream, seeded from PSO_seed and the particle #
+    unsigned seed = Params.PSO_seed;
+    if (seed == 0)
+        seed = static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count());
+    std::cout << "PSO seed " << seed << std::endl;
+
     cost_fnc_cnt = 0;  //counter for # of times cost function is run (# of DD runs)
 
     if (Params.PSO_Clerc_Kennedy == true) {
@@ -287,7 +339,7 @@ Optim::Particle_swarm::Particle_swarm(Parameters &params) : Params(params)  //NO
         phi1 = 2.05;
         phi2 = 2.05;
         phi = phi1 + phi2;
-        chi = 2*kappa/abs(2-phi - sqrt(phi*phi - 4*phi));
+        chi = 2*kappa/std::abs(2-phi - sqrt(phi*phi - 4*phi));
 
         //PSO coefficients WITH Clerc-Kennedy constriction
         w = chi;              // Inertia coefficient
@@ -313,27 +365,37 @@ Optim::Particle_swarm::Particle_swarm(Parameters &params) : Params(params)  //NO
 
     //Initialize global best
     global_best_cost = 1e200;    //since are minimizing, set global best to be very high
+    start_iter = 0;
 
     //---------------------------------------------------------------------------------------
     //Initialization
-    for (int i = 1; i <= n_particles; i++) {
-       Particle *particle = new Particle(n_vars, Params);
+    for (int i = 0; i < n_particles; i++) {
+       std::seed_seq particle_seed{seed, static_cast<unsigned>(i)};
+       std::mt19937 seeder(particle_seed);
+       Particle *particle = new Particle(n_vars, Params, seeder());
 
        for (int dim = 0; dim < n_vars; dim++) {
-            particle->position[dim] = rand_num(Params.vars_min[dim], Params.vars_max[dim]); //use uniformly distributed random number btw min and max value of the variable's range
+            particle->position[dim] = rand_num(Params.vars_min[dim], Params.vars_max[dim], particle->generator); //use uniformly distributed random number btw min and max value of the variable's range
             particle->velocity[dim] = 0;    
 
-
-           //NOTE: for each particle, need to use a different parameter set which corresponds to that particle!
-           //for now do like this--> but later need to make more elegant
-
             *particle->particle_vars[dim] = particle->position[dim];  //change the vars values (which are addresses of the particle_params which need changing)
             std::cout << "particle position " << particle->position[dim] << std::endl;
-
        }
+       particles.push_back(particle);
+    }
 
-       particle->cost = cost_function(particle->particle_params); //run DD to find the cost function for the current particle (parameter set)
-       cost_fnc_cnt++;
+    if (Params.checkpoint_interval > 0)
+        checkpoint_writer.reset(new Checkpoint_writer(Params.checkpoint_file));
+
+    if (Params.resume && load_checkpoint()) {
+        coarse_stage = coarse_iteration(start_iter);
+        return;   //the particles are already evaluated
+    }
+
+    evaluate_particles();  //run DD to find the cost function for each particle (parameter set)
+
+    for (int i = 0; i < n_particles; i++) {
+       Particle *particle = particles[i];
 
        //update the personal best
        particle->best_position = particle->position;
@@ -344,93 +406,189 @@ Optim::Particle_swarm::Particle_swarm(Parameters &params) : Params(params)  //NO
            global_best_cost = particle->best_cost;
            global_best_position = particle->best_position;
        }
-
-       particles.push_back(particle);
     }
+
+    if (checkpoint_writer)
+        save_checkpoint(0);
 }
 
 
+Optim::Particle_swarm::~Particle_swarm()
+{
+    for (size_t i = 0; i < particles.size(); i++)
+        delete particles[i];
+}
+
+
+void Optim::Particle_swarm::evaluate_particles()
+{
+    //all particles use the global best from the previous iteration, so they are independent and
+    //the result doesn't depend on the order in which the particles finish
+    thread_pool->parallel_for(n_particles, [this](int i) {
+        //a particle only matters if it improves on its personal best, so stop its run once it's worse
+        particles[i]->cost = cost_function(particles[i]->particle_params, particles[i]->best_cost);
+    });
+    cost_fnc_cnt += n_particles;
+}
+
 
 void Optim::Particle_swarm::run_PSO()
 {
+    if (Params.PSO_async) {
+        run_PSO_async();
+        return;
+    }
+
     //Main loop of PSO
-    int iter = 0;
+    int iter = start_iter;
 
-    do {
+    while (global_best_cost > Params.fit_tolerance && iter < PSO_max_iters) {
         iter++;
+        coarse_stage = coarse_iteration(iter);
 
-        for (int i = 0; i < n_particles; i++) {  //from 0 b/c of indexing
-            Particle particle = *particles[i]; //need to use this to dereference the pointer and be able to access data memebers
+        for (int i = 0; i < n_particles; i++)  //from 0 b/c of indexing
+            move_particle(*particles[i]);
 
-            //Update Velocity
-            for (int dim = 0; dim < n_vars; dim++) { //update needed for each dimension in cost space
+        //===================================================================================
+        //Evaluation (all particles in parallel)
+        evaluate_particles();
 
-                particle.velocity[dim] = w*particle.velocity[dim]
-                        + c1*rand_num(0.0, 1.0)*(particle.best_position[dim] - particle.position[dim])
-                        + c2*rand_num(0.0, 1.0)*(global_best_position[dim] - particle.position[dim]);
+        for (int i = 0; i < n_particles; i++)
+            update_best(*particles[i]);
 
-                //Update Position
-                particle.position[dim] += particle.velocity[dim];
+        // Store the Best Cost Value at every iteration
+        global_best_costs.push_back(global_best_cost);
+        print_progress(iter);
 
-                //Apply Velocity Limits
-                particle.velocity[dim] = std::max(particle.velocity[dim], min_vel[dim]);
-                particle.velocity[dim] = std::min(particle.velocity[dim], max_vel[dim]);
+        //Damp Inertial  Coefficient in each iteration (note: only used when not using Clerc-Kennedy restriction)
+        w = w * wdamp;
 
-                //Apply Lower and Upper Bound Limits (a clamping mechanism)
-                particle.position[dim] = std::max(particle.position[dim], Params.vars_min[dim]); //if particle position is lower than VarMin, then the position becomes VarMin
-                particle.position[dim] = std::min(particle.position[dim], Params.vars_max[dim]);
+        if (checkpoint_writer && iter % Params.checkpoint_interval == 0)
+            save_checkpoint(iter);
+    }
 
+    if (checkpoint_writer)
+        save_checkpoint(iter);  //so resuming a finished fit doesn't run more iterations
+}
 
-                //===================================================================================
-                //Evaluation
-                //NOTE: for each particle, need to use a different parameter set which corresponds to that particle!
-                //for now do like this--> but later need to make more elegant
 
+void Optim::Particle_swarm::run_PSO_async()
+{
+    //Asynchronous (steady state) PSO: as soon as a particle's evaluation finishes, its bests are updated and it moves using the
+    //current global best, and is queued again. So no thread waits for the slowest particle of an iteration.
+    //The same total # of evaluations as the synchronous PSO is done (PSO_max_iters*n_particles). NOTE: the result depends on the
+    //order in which evaluations finish, so it is not reproducible, even with a fixed PSO_seed.
+    if (global_best_cost <= Params.fit_tolerance || start_iter >= PSO_max_iters)
+        return;   //resumed from the checkpoint of a finished fit
+
+    const int max_evals = cost_fnc_cnt + (PSO_max_iters - start_iter)*n_particles;
+    int num_evals = 0;
+    int iter = start_iter;
+    int scheduled = cost_fnc_cnt;  //# of evaluations started (incl. the ones in the constructor)
+    std::mutex swarm_mutex;        //protects the global best and the particles' positions (a particle is only evaluated by one thread at a time)
+
+    //iter is the # of finished iterations, so the evaluations are of iteration iter+1 (as in the synchronous loop)
+    coarse_stage = coarse_iteration(iter+1);
+    std::vector<int> ids(n_particles);
+    for (int i = 0; i < n_particles; i++) {
+        move_particle(*particles[i]);
+        ids[i] = i;
+    }
+    scheduled += n_particles;
+
+    thread_pool->run_work_stealing(ids, [&](int i) {
+        Particle &particle = *particles[i];
+        particle.cost = cost_function(particle.particle_params, particle.best_cost);
+
+        std::lock_guard<std::mutex> lock(swarm_mutex);
+        cost_fnc_cnt++;
+        num_evals++;
+        update_best(particle);
+
+        //an "iteration" is n_particles evaluations, for the output and the damping of w
+        if (num_evals % n_particles == 0) {
+            iter++;
+            coarse_stage = coarse_iteration(iter+1);
+            global_best_costs.push_back(global_best_cost);
+            print_progress(iter);
+            w = w * wdamp;
+
+            //the particles being evaluated are saved at their last positions, so they are evaluated again after resuming
+            if (checkpoint_writer && iter % Params.checkpoint_interval == 0)
+                save_checkpoint(iter);
+        }
 
-                *particle.particle_vars[dim] = particle.position[dim];  //change the vars values (which are addresses of the particle_params which need changing)
-                std::cout << "particle position " << dim << particle.position[dim] << std::endl;
-            }
+        if (global_best_cost <= Params.fit_tolerance || scheduled >= max_evals)
+            return false;   //this particle is done
 
-            particle.cost = cost_function(particle.particle_params);//call run_DD here with the current particle's parameters....;
-            cost_fnc_cnt++;
+        move_particle(particle);
+        scheduled++;
+        return true;
+    });
 
-            //===================================================================================
+    if (checkpoint_writer)
+        save_checkpoint(iter);
+}
 
-            // Update Personal Best
-            if (particle.cost < particle.best_cost) {
-                 particle.best_position = particle.position;
-                 particle.best_cost = particle.cost;
 
-                 //Update Global Best
-                 if (particle.best_cost < global_best_cost) {
-                    global_best_cost = particle.best_cost;
-                    global_best_position = particle.position;
-                 }
+void Optim::Particle_swarm::move_particle(Particle &particle)
+{
+    //Update Velocity
+    for (int dim = 0; dim < n_vars; dim++) { //update needed for each dimension in cost space
 
-            }
-        }
-        // Store the Best Cost Value at every iteration
-        global_best_costs.push_back(global_best_cost);
+        particle.velocity[dim] = w*particle.velocity[dim]
+                + c1*rand_num(0.0, 1.0, particle.generator)*(particle.best_position[dim] - particle.position[dim])
+                + c2*rand_num(0.0, 1.0, particle.generator)*(global_best_position[dim] - particle.position[dim]);
 
-        std::cout << "Iteration " << iter << ": Best Cost = " << global_best_costs[iter-1]<< std::endl;  //use iter -1 b/c I'm counting iters from 1, but vectors index from 0
-        std::cout << "Photogenrate value " << global_best_position[0] << std::endl;
-        std::cout << "n_mob value " << global_best_position[1] << std::endl;
-        std::cout << "p_mob value " << global_best_position[2] << std::endl;
-        std::cout << "k_rec " << global_best_position[3] << std::endl;
-        std::cout << "Cost function count " << cost_fnc_cnt << std::endl;
+        //Update Position
+        particle.position[dim] += particle.velocity[dim];
 
-        //Damp Inertial  Coefficient in each iteration (note: only used when not using Clerc-Kennedy restriction)
-        w = w * wdamp;
+        //Apply Velocity Limits
+        particle.velocity[dim] = std::max(particle.velocity[dim], min_vel[dim]);
+        particle.velocity[dim] = std::min(particle.velocity[dim], max_vel[dim]);
 
-    } while (global_best_cost > Params.fit_tolerance && iter < PSO_max_iters);
+        //Apply Lower and Upper Bound Limits (a clamping mechanism)
+        particle.position[dim] = std::max(particle.position[dim], Params.vars_min[dim]); //if particle position is lower than VarMin, then the position becomes VarMin
+        particle.position[dim] = std::min(particle.position[dim], Params.vars_max[dim]);
+
+        *particle.particle_vars[dim] = particle.position[dim];  //change the vars values (which are addresses of the particle_params which need changing)
+        std::cout << "particle position " << dim << particle.position[dim] << std::endl;
+    }
+}
+
+
+void Optim::Particle_swarm::update_best(Particle &particle)
+{
+    // Update Personal Best
+    if (particle.cost < particle.best_cost) {
+         particle.best_position = particle.position;
+         particle.best_cost = particle.cost;
+
+         //Update Global Best
+         if (particle.best_cost < global_best_cost) {
+            global_best_cost = particle.best_cost;
+            global_best_position = particle.position;
+         }
+    }
+}
+
+
+void Optim::Particle_swarm::print_progress(int iter)
+{
+    std::cout << "Iteration " << iter << ": Best Cost = " << global_best_costs[iter-1]<< std::endl;  //use iter -1 b/c I'm counting iters from 1, but vectors index from 0
+    std::cout << "Photogenrate value " << global_best_position[0] << std::endl;
+    std::cout << "n_mob value " << global_best_position[1] << std::endl;
+    std::cout << "p_mob value " << global_best_position[2] << std::endl;
+    std::cout << "k_rec " << global_best_position[3] << std::endl;
+    std::cout << "Cost function count " << cost_fnc_cnt << std::endl;
+    if (multi_fidelity)
+        std::cout << "Full resolution runs " << multi_fidelity->get_full_runs() << ", coarse runs " << multi_fidelity->get_coarse_runs() << std::endl;
 }
 
 //--------------------------------------------------------------------------------------------------------------------------
-//generates a uniformly  distributed random number in the range [a,b]
-double Optim::Particle_swarm::rand_num(double a, double b)
+//generates a uniformly  distributed random number in the range [a,b], using the random number stream \param generator
+double Optim::Particle_swarm::rand_num(double a, double b, std::mt19937 &generator)
 {
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    static std::default_random_engine generator(seed);   //NOTE: need static, so is  called only on 1st call (otherwise, since random #'s are pseudo random, will get same # on each call
     std::uniform_real_distribution<double> distribution(a, b);
 
     return distribution(generator);
@@ -438,13 +596,134 @@ double Optim::Particle_swarm::rand_num(double a, double b)
 
 double Optim::Gradient_Descent::rand_num(double a, double b)
 {
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    static std::default_random_engine generator(seed);   //NOTE: need static, so is  called only on 1st call (otherwise, since random #'s are pseudo random, will get same # on each call
+    //NOTE: the generator is a member (seeded once in the constructor), since random #'s are pseudo random, would get same # on each call otherwise
     std::uniform_real_distribution<double> distribution(a, b);
 
     return distribution(generator);
 }
 
+//-----------------------------------------------------------------------------------------------------------------------------------
+//Checkpoints: the state needed to continue the optimization, written in the order it is read back
+
+void Optim::Gradient_Descent::save_checkpoint(int GD_run, int repeat, int var_index)
+{
+    Checkpoint_data data;
+    data.put(1);   //optim_method
+    data.put(static_cast<int>(Params.vars.size()));
+    data.put(GD_run);
+    data.put(repeat);
+    data.put(var_index);
+    data.put(num_searches);
+    data.put(cost_fnc_cnt);
+    data.put(Params.get_var_values());
+    data.put(lsqr_diff);
+    data.put(old_lsqr_diff);
+    data.put(static_cast<int>(overshoot));
+    data.put(sign);
+    data.put(best_lsqr_diff);
+    data.put(best_vars);
+    data.put(generator);
+
+    checkpoint_writer->write(std::move(data));
+}
+
+
+bool Optim::Gradient_Descent::load_checkpoint()
+{
+    try {
+        Checkpoint_data data;
+        if (!Checkpoint_writer::read(Params.checkpoint_file, data))
+            return false;
+
+        if (data.get_int() != 1 || data.get_int() != static_cast<int>(Params.vars.size()))
+            throw std::runtime_error("Checkpoint " + Params.checkpoint_file + " is not from a gradient descent fit of the same variables.");
+        start_run = data.get_int();
+        start_repeat = data.get_int();
+        start_var = data.get_int();
+        num_searches = data.get_int();
+        cost_fnc_cnt = data.get_int();
+        Params.set_var_values(data.get_vector());
+        lsqr_diff = data.get_double();
+        old_lsqr_diff = data.get_double();
+        overshoot = (data.get_int() != 0);
+        sign = data.get_int();
+        best_lsqr_diff = data.get_double();
+        best_vars = data.get_vector();
+        data.get(generator);
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+
+    std::cout << "Resuming from checkpoint " << Params.checkpoint_file << " at restart " << start_run << ", cost function count " << cost_fnc_cnt << std::endl;
+    return true;
+}
+
+
+void Optim::Particle_swarm::save_checkpoint(int iter)
+{
+    Checkpoint_data data;
+    data.put(2);   //optim_method
+    data.put(n_vars);
+    data.put(n_particles);
+    data.put(iter);
+    data.put(cost_fnc_cnt);
+    data.put(w);
+    data.put(global_best_cost);
+    data.put(global_best_position);
+    data.put(global_best_costs);
+
+    for (int i = 0; i < n_particles; i++) {
+        const Particle &particle = *particles[i];
+        data.put(particle.position);
+        data.put(particle.velocity);
+        data.put(particle.best_position);
+        data.put(particle.best_cost);
+        data.put(particle.generator);
+    }
+
+    checkpoint_writer->write(std::move(data));
+}
+
+
+bool Optim::Particle_swarm::load_checkpoint()
+{
+    try {
+        Checkpoint_data data;
+        if (!Checkpoint_writer::read(Params.checkpoint_file, data))
+            return false;
+
+        if (data.get_int() != 2 || data.get_int() != n_vars || data.get_int() != n_particles)
+            throw std::runtime_error("Checkpoint " + Params.checkpoint_file + " is not from a particle swarm fit of the same variables and swarm size.");
+        start_iter = data.get_int();
+        cost_fnc_cnt = data.get_int();
+        w = data.get_double();
+        global_best_cost = data.get_double();
+        global_best_position = data.get_vector();
+        global_best_costs = data.get_vector();
+
+        for (int i = 0; i < n_particles; i++) {
+            Particle &particle = *particles[i];
+            particle.position = data.get_vector();
+            particle.velocity = data.get_vector();
+            particle.best_position = data.get_vector();
+            particle.best_cost = data.get_double();
+            data.get(particle.generator);
+
+            for (int dim = 0; dim < n_vars; dim++)
+                *particle.particle_vars[dim] = particle.position[dim];
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+
+    std::cout << "Resuming from checkpoint " << Params.checkpoint_file << " at iteration " << start_iter << ", cost function count " << cost_fnc_cnt << std::endl;
+    return true;
+}
+
 //-----------------------------------------------------------------------------------------------------------------------------------
 
 //Note: this is not the most elegant way, but for now we use a get_exp_data function definition within each optimization method's class
@@ -489,30 +768,469 @@ void Optim::Particle_swarm::get_exp_data()
 
 //-----------------------------------------------------------------------------------------------------------------------------------
 
-double Optim::Gradient_Descent::cost_function()
+double Optim::Gradient_Descent::cost_function(double max_cost)
 {
-   J_vector_model = run_DD(Params);
-   lsqr_diff = 0;  //rezero
-   //calculate least squares
-   //just compare the J values (V values for experiment and theory should be the same)
-   for (int i = 0; i < J_vector_model.size(); i++) {
-       lsqr_diff += (J_vector_model[i] - J_vector_exp[i])*(J_vector_model[i] - J_vector_exp[i]);
+   Trace_span span("cost_function");
+   //in the first MF_coarse_iters evaluations of the fit, the candidate is run at full resolution only if its coarse cost is
+   //promising. Without a cost to beat it would always be promoted, so then the coarse run is skipped
+   if (multi_fidelity && coarse_evaluation(cost_fnc_cnt) && max_cost < 1e300) {
+       Multi_fidelity::Evaluation evaluation = multi_fidelity->evaluate(Params, max_cost, Params.MF_promote_factor*max_cost);
+       span.set_arg("cost", evaluation.cost);
+       return evaluation.aborted ? 1e200 : evaluation.cost;
    }
 
-   return lsqr_diff;
+   DD_options options;
+   options.write_JV = true;
+   options.gen_rate = &gen_rate;
+   options.J_exp = &J_vector_exp;   //least squares difference is calculated during the sweep
+   options.max_cost = max_cost;
+   DD_result result = solve_DD_cached(Params, options, cache.get());
+   J_vector_model = result.J;
+   span.set_arg("cost", result.cost);
+   span.set_arg("aborted", result.aborted);
+
+   //if the run was stopped, the full cost is unknown (only that it's > max_cost), so make sure this is never taken as a best
+   return result.aborted ? 1e200 : result.cost;
 }
 
 
-double Optim::Particle_swarm::cost_function(Parameters &particle_params)
+double Optim::Particle_swarm::cost_function(const Parameters &particle_params, double max_cost) const
 {
     //NOTE: need to run DD based on the particle positions..., so Params should be different for each particle....
-   J_vector_model = run_DD(particle_params);
-   lsqr_diff = 0;  //rezero
-   //calculate least squares
-   //just compare the J values (V values for experiment and theory should be the same)
+   //all state is local, so this can run in parallel for different particles
+   Trace_span span("cost_function");
+   double cost;
+   if (multi_fidelity && coarse_stage) {
+       cost = multi_fidelity->evaluate(particle_params, max_cost, Params.MF_promote_factor*max_cost).cost;
+   } else {
+       DD_options options;
+       options.gen_rate = &gen_rate;
+       options.J_exp = &J_vector_exp;   //least squares difference is calculated during the sweep
+       options.max_cost = max_cost;
+       cost = solve_DD_cached(particle_params, options, cache.get()).cost;
+   }
+   span.set_arg("cost", cost);
+   return cost;
+}
+
+
+
+//-----------------------------------------------------------------------------------------------------------------------------------
+//Surrogate model assisted fitting
+
+Optim::Surrogate::Surrogate(Parameters &params) : Params(params)
+{
+    //read in experimental curve into vectors--> since it never changes, just do once
+    std::ifstream exp_JV;
+    exp_JV.open(params.exp_data_file_name);
+    //check if file was opened
+    if (!exp_JV) {
+        std::cerr << "Unable to open file " << params.exp_data_file_name <<"\n";
+        exit(1);   // call system to stop
+    }
+
+    double temp_V, temp_J;   //for input until end of file
+    while (exp_JV >> temp_V >> temp_J) {  //there are 2 entries / line
+        V_vector.push_back(temp_V);
+        J_vector_exp.push_back(temp_J);
+    }
+
+    gen_rate = Photogeneration::read_gen_rate(Params, Params.GenRateFileName);
+    if (Params.warm_start_cache_size > 0)
+        cache.reset(new Solution_cache(Params, Params.warm_start_cache_size));
+
+    n_vars = Params.vars.size();
+    n_init = Params.surrogate_init_points;
+    max_evals = static_cast<int>(Params.optim_max_iter);
+    cost_fnc_cnt = 0;
+    best_cost = 1e200;
+
+    int num_threads = (Params.num_threads > 0) ? Params.num_threads : Thread_pool::hardware_threads();
+    thread_pool.reset(new Thread_pool(num_threads));
+
+    unsigned seed = Params.surrogate_seed;
+    if (seed == 0)
+        seed = static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count());
+    std::cout << "Surrogate fit seed " << seed << ", " << thread_pool->size() << " threads" << std::endl;
+    generator.seed(seed);
+}
+
+
+Parameters Optim::Surrogate::to_params(const std::vector<double> &x) const
+{
+    Parameters run_params = Params;
+
+    //same order as in Params.vars (the pointers in vars point to Params, not to the copy)
+    std::vector<double*> run_vars = {&run_params.Photogen_scaling, &run_params.n_mob_active, &run_params.p_mob_active, &run_params.k_rec};
+
+    for (int dim = 0; dim < n_vars; dim++) {
+        double min = Params.vars_min[dim], max = Params.vars_max[dim];
+        if (min > 0)
+            *run_vars[dim] = min*pow(max/min, x[dim]);   //log scale
+        else
+            *run_vars[dim] = min + (max - min)*x[dim];
+    }
+
+    return run_params;
+}
+
+
+double Optim::Surrogate::cost_function(const Parameters &run_params) const
+{
+   Trace_span span("cost_function");
+   DD_options options;
+   options.gen_rate = &gen_rate;
+   std::vector<double> J_vector_model = solve_DD_cached(run_params, options, cache.get()).J;
+   double lsqr_diff = 0;
    for (int i =0; i < J_vector_model.size(); i++) {
        lsqr_diff += (J_vector_model[i] - J_vector_exp[i])*(J_vector_model[i] - J_vector_exp[i]);
    }
+   span.set_arg("cost", lsqr_diff);
 
    return lsqr_diff;
 }
+
+
+void Optim::Surrogate::evaluate(const std::vector<std::vector<double> > &new_points)
+{
+    std::vector<double> new_costs(new_points.size());
+    thread_pool->parallel_for(new_points.size(), [&](int i) {
+        new_costs[i] = cost_function(to_params(new_points[i]));
+    });
+
+    for (size_t i = 0; i < new_points.size(); i++) {
+        points.push_back(new_points[i]);
+        costs.push_back(new_costs[i]);
+        cost_fnc_cnt++;
+        if (new_costs[i] < best_cost) {
+            best_cost = new_costs[i];
+            best_point = new_points[i];
+        }
+    }
+}
+
+
+std::vector<double> Optim::Surrogate::maximize_EI(const Gaussian_process &model, double best_value)
+{
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    std::vector<double> x(n_vars), best_x(n_vars);
+    double best_EI = -1.0;
+
+    //random candidates: half uniform in the whole range, half close to the best point so far
+    const int num_candidates = 2000;
+    for (int c = 0; c < num_candidates; c++) {
+        double spread = (c % 2 == 0) ? 0.02 : 0.1;
+        for (int dim = 0; dim < n_vars; dim++) {
+            if (c < num_candidates/2)
+                x[dim] = uniform(generator);
+            else
+                x[dim] = std::min(1.0, std::max(0.0, best_point[dim] + spread*normal(generator)));
+        }
+        double EI = model.expected_improvement(x, best_value);
+        if (EI > best_EI) {
+            best_EI = EI;
+            best_x = x;
+        }
+    }
+
+    //local pattern search from the best candidate
+    for (double step = 0.05; step > 1e-4; step /= 2) {
+        bool improved = true;
+        while (improved) {
+            improved = false;
+            for (int dim = 0; dim < n_vars; dim++) {
+                for (int sign = -1; sign <= 1; sign += 2) {
+                    x = best_x;
+                    x[dim] = std::min(1.0, std::max(0.0, x[dim] + sign*step));
+                    double EI = model.expected_improvement(x, best_value);
+                    if (EI > best_EI) {
+                        best_EI = EI;
+                        best_x = x;
+                        improved = true;
+                    }
+                }
+            }
+        }
+    }
+
+    return best_x;
+}
+
+
+void Optim::Surrogate::run_surrogate()
+{
+    const int batch_size = thread_pool->size();
+
+    //initial design: Latin hypercube, so each variable's range is evenly covered
+    std::vector<std::vector<double> > new_points(n_init, std::vector<double>(n_vars));
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (int dim = 0; dim < n_vars; dim++) {
+        std::vector<int> order(n_init);
+        for (int i = 0; i < n_init; i++) order[i] = i;
+        std::shuffle(order.begin(), order.end(), generator);
+        for (int i = 0; i < n_init; i++)
+            new_points[i][dim] = (order[i] + uniform(generator))/n_init;
+    }
+    evaluate(new_points);
+
+    Gaussian_process model;
+    int iter = 0;
+
+    while (best_cost > Params.fit_tolerance && cost_fnc_cnt < max_evals) {
+        iter++;
+
+        //the model is fit to log(cost), since the cost varies over orders of magnitude
+        std::vector<std::vector<double> > model_points = points;
+        std::vector<double> model_values(costs.size());
+        for (size_t i = 0; i < costs.size(); i++) model_values[i] = log(costs[i] + 1e-300);
+        model.fit(model_points, model_values);
+        double best_value = log(best_cost + 1e-300);
+
+        //choose a batch of points to run in parallel. After choosing a point, the model's prediction is used as its value,
+        //so the next point is chosen somewhere else
+        new_points.clear();
+        int num_new = std::min(batch_size, max_evals - cost_fnc_cnt);
+        for (int b = 0; b < num_new; b++) {
+            std::vector<double> x = maximize_EI(model, best_value);
+            new_points.push_back(x);
+            if (b < num_new - 1) {
+                double mean, std_dev;
+                model.predict(x, mean, std_dev);
+                model_points.push_back(x);
+                model_values.push_back(mean);
+                model.fit(model_points, model_values, false);
+            }
+        }
+        evaluate(new_points);
+
+        Parameters best_params = to_params(best_point);
+        std::cout << "Iteration " << iter << ": Best Cost = " << best_cost << std::endl;
+        std::cout << "Photogenrate value " << best_params.Photogen_scaling << std::endl;
+        std::cout << "n_mob value " << best_params.n_mob_active << std::endl;
+        std::cout << "p_mob value " << best_params.p_mob_active << std::endl;
+        std::cout << "k_rec " << best_params.k_rec << std::endl;
+        std::cout << "Cost function count " << cost_fnc_cnt << std::endl;
+    }
+
+    //store the best parameters
+    Parameters best_params = to_params(best_point);
+    Params.Photogen_scaling = best_params.Photogen_scaling;
+    Params.n_mob_active = best_params.n_mob_active;
+    Params.p_mob_active = best_params.p_mob_active;
+    Params.k_rec = best_params.k_rec;
+
+    std::cout << "Run Summary: " << std::endl;
+    std::cout << "Best Cost: " << best_cost << std::endl;
+    std::cout << "Cost function count " << cost_fnc_cnt << std::endl;
+    std::cout << "Best parameter values are " << std::endl;
+    for (int i = 0; i < n_vars; i++)
+        std::cout << *Params.vars[i] << std::endl;
+}
+
+
+//-----------------------------------------------------------------------------------------------------------------------------------
+//Levenberg-Marquardt fit
+
+Optim::Levenberg_Marquardt::Levenberg_Marquardt(Parameters &params) : Params(params)
+{
+    //read in experimental curve into vectors--> since it never changes, just do once
+    std::ifstream exp_JV;
+    exp_JV.open(params.exp_data_file_name);
+    //check if file was opened
+    if (!exp_JV) {
+        std::cerr << "Unable to open file " << params.exp_data_file_name <<"\n";
+        exit(1);   // call system to stop
+    }
+
+    double temp_V, temp_J;   //for input until end of file
+    while (exp_JV >> temp_V >> temp_J)  //there are 2 entries / line
+        J_vector_exp.push_back(temp_J);
+
+    gen_rate = Photogeneration::read_gen_rate(Params, Params.GenRateFileName);
+
+    n_vars = Params.vars.size();
+    cost_fnc_cnt = 0;
+    for (int i = 0; i < n_vars; i++) {
+        u_min.push_back(log(Params.vars_min[i]));
+        u_max.push_back(log(Params.vars_max[i]));
+    }
+
+    int num_threads = (Params.num_threads > 0) ? Params.num_threads : Thread_pool::hardware_threads();
+    thread_pool.reset(new Thread_pool(std::min(num_threads, n_vars)));
+}
+
+
+DD_result Optim::Levenberg_Marquardt::run(const std::vector<double> &u, bool sensitivities, double max_cost)
+{
+    std::vector<double> values = Params.get_var_values();
+    for (int i = 0; i < n_vars; i++)
+        values[i] = exp(u[i]);
+    Parameters run_params = Params;
+    run_params.set_var_values(values);
+
+    DD_options options;
+    options.gen_rate = &gen_rate;
+    options.J_exp = &J_vector_exp;
+    options.max_cost = max_cost;
+    options.compute_sensitivities = sensitivities;
+
+    Trace_span span("cost_function");
+    DD_result result = solve_DD(run_params, options);
+    span.set_arg("cost", result.cost);
+    span.set_arg("aborted", result.aborted);
+    return result;
+}
+
+
+void Optim::Levenberg_Marquardt::residuals_and_jacobian(const std::vector<double> &u, const DD_result &result, std::vector<double> &r, std::vector<double> &jac)
+{
+    const int num_res = std::min(result.J.size(), J_vector_exp.size());
+    r.resize(num_res);
+    jac.resize(num_res*n_vars);
+    for (int i = 0; i < num_res; i++)
+        r[i] = result.J[i] - J_vector_exp[i];
+
+    const bool use_sensitivities = (Params.LM_jacobian == 1 && !result.sensitivities_failed);
+    if (Params.LM_jacobian == 1 && result.sensitivities_failed)
+        std::cout << "Levenberg-Marquardt: the sensitivities failed, using finite differences for this step" << std::endl;
+
+    if (use_sensitivities) {
+        //dr/du = var*dJ/dvar
+        for (int i = 0; i < num_res; i++)
+            for (int k = 0; k < n_vars; k++)
+                jac[i*n_vars + k] = exp(u[k])*result.dJ_dvars[i][k];
+    } else {
+        //forward differences, all columns in parallel
+        const double h = 1e-4;
+        std::vector<std::vector<double> > J_perturbed(n_vars);
+        thread_pool->parallel_for(n_vars, [&](int k) {
+            std::vector<double> u_k = u;
+            u_k[k] += h;
+            J_perturbed[k] = run(u_k, false).J;
+        });
+        cost_fnc_cnt += n_vars;
+        for (int i = 0; i < num_res; i++)
+            for (int k = 0; k < n_vars; k++)
+                jac[i*n_vars + k] = (J_perturbed[k][i] - result.J[i])/h;
+    }
+}
+
+
+bool Optim::Levenberg_Marquardt::solve_linear(std::vector<double> A, std::vector<double> b, std::vector<double> &x, int n)
+{
+    //Gaussian elimination with partial pivoting
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int row = col+1; row < n; row++)
+            if (std::abs(A[row*n + col]) > std::abs(A[pivot*n + col])) pivot = row;
+        if (A[pivot*n + col] == 0.0) return false;
+        if (pivot != col) {
+            for (int k = 0; k < n; k++) std::swap(A[col*n + k], A[pivot*n + k]);
+            std::swap(b[col], b[pivot]);
+        }
+        for (int row = col+1; row < n; row++) {
+            double factor = A[row*n + col]/A[col*n + col];
+            for (int k = col; k < n; k++) A[row*n + k] -= factor*A[col*n + k];
+            b[row] -= factor*b[col];
+        }
+    }
+    x.resize(n);
+    for (int row = n-1; row >= 0; row--) {
+        double sum = b[row];
+        for (int k = row+1; k < n; k++) sum -= A[row*n + k]*x[k];
+        x[row] = sum/A[row*n + row];
+    }
+    return true;
+}
+
+
+void Optim::Levenberg_Marquardt::run_LM()
+{
+    //start from the values in the parameters file (within the ranges)
+    std::vector<double> values = Params.get_var_values();
+    std::vector<double> u(n_vars), u_new(n_vars), du;
+    for (int k = 0; k < n_vars; k++)
+        u[k] = std::min(u_max[k], std::max(u_min[k], log(values[k])));
+
+    const bool sensitivities = (Params.LM_jacobian == 1);
+    std::vector<double> r, jac;
+    DD_result result = run(u, sensitivities);
+    cost_fnc_cnt++;
+    double cost = result.cost;
+    residuals_and_jacobian(u, result, r, jac);
+    double lambda = 1e-3;
+    const int max_steps = static_cast<int>(Params.optim_max_iter);
+    const int num_res = r.size();
+
+    for (int iter = 1; iter <= max_steps && cost > Params.fit_tolerance; iter++) {
+
+        //normal equations
+        std::vector<double> JTJ(n_vars*n_vars, 0.0), JTr(n_vars, 0.0);
+        for (int i = 0; i < num_res; i++) {
+            for (int k = 0; k < n_vars; k++) {
+                JTr[k] -= jac[i*n_vars + k]*r[i];
+                for (int l = 0; l < n_vars; l++)
+                    JTJ[k*n_vars + l] += jac[i*n_vars + k]*jac[i*n_vars + l];
+            }
+        }
+
+        //increase lambda until the step reduces the cost
+        bool accepted = false;
+        while (!accepted && lambda < 1e12) {
+            std::vector<double> A = JTJ;
+            for (int k = 0; k < n_vars; k++)
+                A[k*n_vars + k] += lambda*std::max(JTJ[k*n_vars + k], 1e-30);
+            if (!solve_linear(A, JTr, du, n_vars)) {
+                lambda *= 10;
+                continue;
+            }
+            for (int k = 0; k < n_vars; k++)
+                u_new[k] = std::min(u_max[k], std::max(u_min[k], u[k] + du[k]));
+
+            //only need to know if the cost decreases, so the run can be stopped early
+            result = run(u_new, sensitivities, cost);
+            cost_fnc_cnt++;
+            if (!result.aborted && result.cost < cost) {
+                accepted = true;
+                lambda = std::max(lambda/10, 1e-12);
+            } else {
+                lambda *= 10;
+            }
+        }
+        if (!accepted) {
+            std::cout << "Levenberg-Marquardt: no further decrease of the cost" << std::endl;
+            break;
+        }
+
+        double max_step = 0.0;
+        for (int k = 0; k < n_vars; k++)
+            max_step = std::max(max_step, std::abs(u_new[k] - u[k]));
+        u = u_new;
+        cost = result.cost;
+        residuals_and_jacobian(u, result, r, jac);
+
+        std::cout << "Iteration " << iter << ": Best Cost = " << cost << std::endl;
+        std::cout << "Photogenrate value " << exp(u[0]) << std::endl;
+        std::cout << "n_mob value " << exp(u[1]) << std::endl;
+        std::cout << "p_mob value " << exp(u[2]) << std::endl;
+        std::cout << "k_rec " << exp(u[3]) << std::endl;
+        std::cout << "Cost function count " << cost_fnc_cnt << std::endl;
+
+        if (max_step < 1e-8)
+            break;   //converged
+    }
+
+    //store the best parameters
+    for (int k = 0; k < n_vars; k++)
+        values[k] = exp(u[k]);
+    Params.set_var_values(values);
+
+    std::cout << "Run Summary: " << std::endl;
+    std::cout << "Best Cost: " << cost << std::endl;
+    std::cout << "Cost function count " << cost_fnc_cnt << std::endl;
+    std::cout << "Best parameter values are " << std::endl;
+    for (int i = 0; i < n_vars; i++)
+        std::cout << *Params.vars[i] << std::endl;
+}
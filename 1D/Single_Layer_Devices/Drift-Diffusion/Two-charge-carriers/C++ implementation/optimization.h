@@ -11,9 +11,18 @@
 #include <time.h>
 #include <fstream>
 #include <string>
+#include <random>
+#include <memory>
+#include <mutex>
+#include <atomic>
 
 #include "run_DD.h"
 #include "parameters.h"
+#include "thread_pool.h"
+#include "gaussian_process.h"
+#include "solution_cache.h"
+#include "multi_fidelity.h"
+#include "checkpoint.h"
 
 //This provides the namespace and class definitions
 
@@ -26,7 +35,9 @@ namespace Optim  //group all the optimization classes
     public:
         Gradient_Descent(Parameters &params);
         void run_GD();
-        double cost_function();
+        double cost_function(double max_cost = 1e300);  //the run stops once the cost is > max_cost (then returns 1e200)
+        //!True if cost function evaluation \param eval (0 = the 1st of the fit, i.e. cost_fnc_cnt) uses the multi-fidelity (coarse) evaluation
+        bool coarse_evaluation(int eval) const {return eval < Params.MF_coarse_iters;}
         void get_exp_data();
         double rand_num(double a, double b);   //SHOULD later make this function defined somewhere like a new Utilities class for the code
 
@@ -53,6 +64,24 @@ namespace Optim  //group all the optimization classes
         std::vector<double> J_vector_model;
         std::ifstream exp_JV;
 
+        std::vector<double> gen_rate;   //generation rate profile, read from file once and shared by all runs
+        std::unique_ptr<Solution_cache> cache;  //converged solutions of previous runs, for warm starts (null if not used)
+        std::unique_ptr<Multi_fidelity> multi_fidelity;  //coarse level runs for the first MF_coarse_iters iterations (null if not used)
+
+        int cost_fnc_cnt;  //counter to count # of cost function calls (# of times DD model is run)
+        std::default_random_engine generator;  //for the random restarts
+
+        //checkpoints are saved at the start of a variable search. When resuming, the loops start at the saved GD run, repeat and variable
+        std::unique_ptr<Checkpoint_writer> checkpoint_writer;  //null if checkpoints are off
+        int num_searches;  //# of variable searches started
+        int start_run, start_repeat, start_var;
+        bool resumed;      //true until the search saved in the checkpoint is started
+
+        //!Saves the state at the start of the search for variable \param var_index (in \param GD_run, \param repeat)
+        void save_checkpoint(int GD_run, int repeat, int var_index);
+
+        //!Restores the state from Params.checkpoint_file. Returns false if there is no checkpoint.
+        bool load_checkpoint();
     };
 
 
@@ -61,10 +90,13 @@ namespace Optim  //group all the optimization classes
     {
     public:
         Particle_swarm(Parameters &params);
+        ~Particle_swarm();
         void run_PSO();
-        double cost_function(Parameters &particle_params);
+        //!Thread safe, so particles can be evaluated in parallel. The run stops as soon as the cost is > \param max_cost
+        //! (then the returned cost is only that of the voltages done, but still > max_cost).
+        double cost_function(const Parameters &particle_params, double max_cost = 1e300) const;
         void get_exp_data();
-        double rand_num(double a, double b);
+        double rand_num(double a, double b, std::mt19937 &generator);
 
     private:
 
@@ -96,7 +128,7 @@ namespace Optim  //group all the optimization classes
 
         struct Particle
         {
-            Particle::Particle(int n_vars, Parameters &params);
+            Particle(int n_vars, const Parameters &params, unsigned seed);
             Parameters particle_params;   //NOTE: this is a COPY, not a reference, since want to change each particle's params individually.
             std::vector<double*> particle_vars;  //this vector contains POINTERS to the variables in particle_params which need to be changed
             std::vector<double> position;
@@ -104,22 +136,132 @@ namespace Optim  //group all the optimization classes
             double cost;   //cost (aka objective) function which are minimizing, in our case will be least squares difference
             std::vector<double> best_position;
             double best_cost;
-
+            std::mt19937 generator;   //each particle has its own random number stream, so results don't depend on the # of threads
         };
 
+        //!Runs the DD simulations for all particles in parallel and updates their cost
+        void evaluate_particles();
+
+        //!Asynchronous PSO (used if PSO_async): each particle moves as soon as its own evaluation is done, using the current global best.
+        //! The evaluations are scheduled on the thread pool with work stealing.
+        void run_PSO_async();
+
+        //!Updates the velocity and position of \param particle (using the current global best) and sets its parameters
+        void move_particle(Particle &particle);
+
+        //!Updates the personal best of \param particle and the global best with the particle's cost
+        void update_best(Particle &particle);
+
+        void print_progress(int iter);
+
+        //!True if the evaluations of iteration \param iter (0 = the initial evaluation) use the multi-fidelity (coarse) evaluation
+        bool coarse_iteration(int iter) const {return iter < Params.MF_coarse_iters;}
+
+        //!Saves the swarm state after \param iter iterations (the file is written on the checkpoint writer thread)
+        void save_checkpoint(int iter);
+
+        //!Restores the swarm state from Params.checkpoint_file. Returns false if there is no checkpoint.
+        bool load_checkpoint();
+
         std::vector<Particle*> particles;  //NOTE: this declaration must follow after the struct Particle definition, otherwise, it doesn't know what a Paricle is!//vector of pointers to particles
 
         std::vector<double> V_vector;
         std::vector<double> J_vector_exp;
-        double lsqr_diff, old_lsqr_diff;
-        std::vector<double> J_vector_model;
+        std::vector<double> gen_rate;   //generation rate profile, read from file once and shared by all runs
+        std::unique_ptr<Solution_cache> cache;  //converged solutions of previous runs, for warm starts (null if not used)
+        std::unique_ptr<Multi_fidelity> multi_fidelity;  //coarse level runs for the first MF_coarse_iters iterations (null if not used)
+        std::atomic<bool> coarse_stage;  //true while the multi-fidelity evaluation is used
+
+        int start_iter;  //# of iterations already done (> 0 if resumed from a checkpoint)
+        std::unique_ptr<Checkpoint_writer> checkpoint_writer;  //null if checkpoints are off
 
+        std::unique_ptr<Thread_pool> thread_pool;
 
         std::ifstream exp_JV;
 
     };
 
 
+
+    //----------------------------------------------------------------------------------------------------
+    //!Surrogate model assisted fitting: a Gaussian process model of log(cost) is fit to all the DD runs done so far,
+    //! and the next parameter sets are the ones with max expected improvement according to the model.
+    //! The variables are scaled logarithmically to [0,1], since they span orders of magnitude.
+    //! In each step, as many parameter sets as threads are chosen (using the model's prediction as a temporary value for the
+    //! already chosen ones) and run in parallel. Params.optim_max_iter is the max # of DD runs.
+    class Surrogate
+    {
+    public:
+        Surrogate(Parameters &params);
+        void run_surrogate();
+        double cost_function(const Parameters &run_params) const;  //thread safe
+
+    private:
+        Parameters &Params;
+
+        int n_vars;
+        int n_init;        //# of initial (space filling) parameter sets
+        int max_evals;     //max # of DD runs
+        int cost_fnc_cnt;
+
+        std::vector<std::vector<double> > points;  //all evaluated parameter sets (scaled to [0,1])
+        std::vector<double> costs;
+        double best_cost;
+        std::vector<double> best_point;
+
+        std::mt19937 generator;
+        std::unique_ptr<Thread_pool> thread_pool;
+
+        std::vector<double> V_vector;
+        std::vector<double> J_vector_exp;
+        std::vector<double> gen_rate;
+        std::unique_ptr<Solution_cache> cache;
+
+        //!Converts the scaled point \param x to a Parameters object (a copy of Params with the vars changed)
+        Parameters to_params(const std::vector<double> &x) const;
+
+        //!Runs DD for all the points in \param new_points in parallel and stores the results
+        void evaluate(const std::vector<std::vector<double> > &new_points);
+
+        //!Finds the point with the max expected improvement of the \param model. Random candidates are tried, followed by a
+        //! local pattern search around the best candidate.
+        std::vector<double> maximize_EI(const Gaussian_process &model, double best_value);
+    };
+
+
+    //----------------------------------------------------------------------------------------------------
+    //!Levenberg-Marquardt least squares fit. The residuals are r = J_model - J_exp at each voltage, and the variables are
+    //! u = log(var), since they span orders of magnitude. Each step solves (Jac^T*Jac + lambda*diag(Jac^T*Jac))*du = -Jac^T*r,
+    //! where Jac = dr/du is found by sensitivity analysis (in the same run as r) or by finite differences (one run per variable, in parallel).
+    //! Starts from the values in parameters.inp, Params.optim_max_iter is the max # of steps.
+    class Levenberg_Marquardt
+    {
+    public:
+        Levenberg_Marquardt(Parameters &params);
+        void run_LM();
+
+    private:
+        Parameters &Params;
+
+        int n_vars;
+        int cost_fnc_cnt;
+        std::vector<double> u_min, u_max;   //bounds of the log variables
+
+        std::vector<double> J_vector_exp;
+        std::vector<double> gen_rate;
+        std::unique_ptr<Thread_pool> thread_pool;
+
+        //!Runs DD for the log variables \param u. The run stops once the cost is > \param max_cost.
+        DD_result run(const std::vector<double> &u, bool sensitivities, double max_cost = 1e300);
+
+        //!Finds the residuals \param r and the Jacobian \param jac (row major, # of residuals x n_vars) at \param u,
+        //! where \param base is the run at u.
+        void residuals_and_jacobian(const std::vector<double> &u, const DD_result &base, std::vector<double> &r, std::vector<double> &jac);
+
+        //!Solves the n x n system \param A * \param x = \param b by Gaussian elimination. Returns false if A is singular.
+        static bool solve_linear(std::vector<double> A, std::vector<double> b, std::vector<double> &x, int n);
+    };
+
 }
 
 #endif // OPTIMIZATION_H
@@ -1,5 +1,7 @@
 #include "parameters.h"
 
+#include <stdexcept>
+
 
 void Parameters::Initialize()
 {
@@ -65,6 +67,37 @@ void Parameters::Initialize()
         isPositive(tol_relax_factor,comment);
         parameters >> GenRateFileName >> comment;
 
+        parameters >> comment;  //skip line which categorizes the solver params
+        parameters >> solver_method >> comment;
+        if (solver_method != 1 && solver_method != 2)
+            throw std::runtime_error("Invalid input. solver_method must be 1 (Gummel) or 2 (Newton).");
+        parameters >> mixing_method >> comment;
+        if (mixing_method != 1 && mixing_method != 2)
+            throw std::runtime_error("Invalid input. mixing_method must be 1 (linear) or 2 (Anderson).");
+        parameters >> Anderson_depth >> comment;
+        isPositive(Anderson_depth, comment);
+        parameters >> num_threads >> comment;
+        if (num_threads < 0)
+            throw std::runtime_error("Invalid input. num_threads must be >= 0 (0 uses all hardware threads).");
+        parameters >> details_output >> comment;
+        if (details_output < 0 || details_output > 2)
+            throw std::runtime_error("Invalid input. details_output must be 0 (none), 1 (text files) or 2 (binary snapshot file).");
+        parameters >> output_voltages >> comment;
+        parameters >> output_fields >> comment;
+        parameters >> output_region >> comment;
+        parameters >> output_decimation >> comment;
+        output_policy();  //throws if the output specifications are invalid
+        parameters >> timing_report >> comment;
+        parameters >> hardware_counters >> comment;
+        parameters >> trace_file >> comment;
+        parameters >> trace_buffer_size >> comment;
+        if (trace_buffer_size < 1)
+            throw std::runtime_error("Invalid input. trace_buffer_size must be >= 1.");
+
+        parameters >> comment;  //skip line which categorizes the batch params
+        parameters >> batch_file_name >> comment;
+        parameters >> batch_output_file_name >> comment;
+
         parameters >> comment;  //skip line which categorizes the optimization params
         //optimization parameters
         parameters >> auto_fit >> comment;
@@ -76,6 +109,9 @@ void Parameters::Initialize()
             parameters >> fit_tolerance >> comment;
             isPositive(fit_tolerance,comment);
             parameters >> exp_data_file_name >> comment;
+            parameters >> warm_start_cache_size >> comment;
+            if (warm_start_cache_size < 0)
+                throw std::runtime_error("Invalid input. warm_start_cache_size must be >= 0.");
 
             parameters >> comment;
             //now read in the min and max ranges for optimization purpose
@@ -107,11 +143,46 @@ void Parameters::Initialize()
             vars_min.push_back(k_rec_min);
             vars_max.push_back(k_rec_max);
 
-            if (optim_method == 2) {
-                //read in the PSO parameters
-                parameters >> comment;
-                parameters >> PSO_Clerc_Kennedy >> comment;
-            }
+            //read in the PSO parameters
+            parameters >> comment;
+            parameters >> PSO_Clerc_Kennedy >> comment;
+            parameters >> PSO_seed >> comment;
+            parameters >> PSO_async >> comment;
+
+            //surrogate model fit parameters
+            parameters >> comment;
+            parameters >> surrogate_init_points >> comment;
+            isPositive(surrogate_init_points, comment);
+            parameters >> surrogate_seed >> comment;
+
+            //Levenberg-Marquardt parameters
+            parameters >> comment;
+            parameters >> LM_jacobian >> comment;
+            if (LM_jacobian != 1 && LM_jacobian != 2)
+                throw std::runtime_error("Invalid input. LM_jacobian must be 1 (sensitivity analysis) or 2 (finite differences).");
+
+            //multi-fidelity parameters
+            parameters >> comment;
+            parameters >> MF_mesh_factor >> comment;
+            isPositive(MF_mesh_factor, comment);
+            if (num_cell % MF_mesh_factor != 0)
+                throw std::runtime_error("Invalid input. num_cell must be divisible by MF_mesh_factor.");
+            parameters >> MF_Va_stride >> comment;
+            isPositive(MF_Va_stride, comment);
+            parameters >> MF_promote_factor >> comment;
+            if (MF_promote_factor < 1.0)
+                throw std::runtime_error("Invalid input. MF_promote_factor must be >= 1.");
+            parameters >> MF_coarse_iters >> comment;
+            if (MF_coarse_iters < 0)
+                throw std::runtime_error("Invalid input. MF_coarse_iters must be >= 0.");
+
+            //checkpoint parameters
+            parameters >> comment;
+            parameters >> checkpoint_interval >> comment;
+            if (checkpoint_interval < 0)
+                throw std::runtime_error("Invalid input. checkpoint_interval must be >= 0.");
+            parameters >> checkpoint_file >> comment;
+            parameters >> resume >> comment;
         }
 
         parameters.close();
@@ -162,3 +233,85 @@ void Parameters::isNegative(int input, const std::string &comment)
     }
 
 }
+
+
+bool Parameters::set_value(const std::string &name, const std::string &value)
+{
+    static const std::pair<const char*, double Parameters::*> double_params[] = {
+        {"L", &Parameters::L}, {"N_LUMO", &Parameters::N_LUMO}, {"N_HOMO", &Parameters::N_HOMO},
+        {"Photogen_scaling", &Parameters::Photogen_scaling}, {"phi_a", &Parameters::phi_a}, {"phi_c", &Parameters::phi_c},
+        {"eps_active", &Parameters::eps_active}, {"p_mob_active", &Parameters::p_mob_active}, {"n_mob_active", &Parameters::n_mob_active},
+        {"mobil", &Parameters::mobil}, {"E_gap", &Parameters::E_gap}, {"active_CB", &Parameters::active_CB},
+        {"active_VB", &Parameters::active_VB}, {"WF_anode", &Parameters::WF_anode}, {"WF_cathode", &Parameters::WF_cathode},
+        {"k_rec", &Parameters::k_rec}, {"dx", &Parameters::dx}, {"Va_min", &Parameters::Va_min}, {"Va_max", &Parameters::Va_max},
+        {"increment", &Parameters::increment}, {"w_eq", &Parameters::w_eq}, {"w_i", &Parameters::w_i},
+        {"tolerance_i", &Parameters::tolerance_i}, {"w_reduce_factor", &Parameters::w_reduce_factor},
+        {"tol_relax_factor", &Parameters::tol_relax_factor}};
+    static const std::pair<const char*, int Parameters::*> int_params[] = {
+        {"num_cell", &Parameters::num_cell}, {"solver_method", &Parameters::solver_method},
+        {"mixing_method", &Parameters::mixing_method}, {"Anderson_depth", &Parameters::Anderson_depth}};
+
+    if (name == "GenRateFileName") {
+        GenRateFileName = value;
+        return true;
+    }
+
+    try {
+        for (size_t i = 0; i < sizeof(double_params)/sizeof(double_params[0]); i++) {
+            if (name == double_params[i].first) {
+                this->*double_params[i].second = std::stod(value);
+                N = N_HOMO;   //as in Initialize
+                return true;
+            }
+        }
+        for (size_t i = 0; i < sizeof(int_params)/sizeof(int_params[0]); i++) {
+            if (name == int_params[i].first) {
+                this->*int_params[i].second = std::stoi(value);
+                return true;
+            }
+        }
+    }
+    catch (std::logic_error &) {  //std::invalid_argument or std::out_of_range
+        throw std::runtime_error("Invalid value " + value + " for " + name);
+    }
+
+    return false;
+}
+
+void Parameters::check_values()
+{
+    isPositive(L, "L");
+    isPositive(num_cell, "num_cell");
+    isPositive(N_LUMO, "N_LUMO");
+    isPositive(N_HOMO, "N_HOMO");
+    isPositive(Photogen_scaling, "Photogen_scaling");
+    isPositive(eps_active, "eps_active");
+    isPositive(p_mob_active, "p_mob_active");
+    isPositive(n_mob_active, "n_mob_active");
+    isPositive(mobil, "mobil");
+    isPositive(E_gap, "E_gap");
+    isNegative(active_CB, "active_CB");
+    isNegative(active_VB, "active_VB");
+    isPositive(WF_anode, "WF_anode");
+    isPositive(WF_cathode, "WF_cathode");
+    isPositive(k_rec, "k_rec");
+    isPositive(dx, "dx");
+    isPositive(increment, "increment");
+    isPositive(w_eq, "w_eq");
+    isPositive(w_i, "w_i");
+    isPositive(tolerance_i, "tolerance_i");
+    isPositive(w_reduce_factor, "w_reduce_factor");
+    isPositive(tol_relax_factor, "tol_relax_factor");
+    if (solver_method != 1 && solver_method != 2)
+        throw std::runtime_error("Invalid input. solver_method must be 1 (Gummel) or 2 (Newton).");
+    if (mixing_method != 1 && mixing_method != 2)
+        throw std::runtime_error("Invalid input. mixing_method must be 1 (linear) or 2 (Anderson).");
+    isPositive(Anderson_depth, "Anderson_depth");
+}
+
+
+Output_policy Parameters::output_policy() const
+{
+    return Output_policy(output_voltages, output_fields, output_region, output_decimation,
+                         {"V", "p", "n", "J_total", "Un", "G", "R_Langevin"}, {"x"}, increment, dx);
+}
@@ -9,6 +9,8 @@
 #include <iomanip>
 #include <vector>
 
+#include "output_policy.h"
+
 
 struct Parameters   //parameters need to be accessble, so all members are public.
 {
@@ -26,6 +28,15 @@ struct Parameters   //parameters need to be accessble, so all members are public
     void isNegative(double input, const std::string &comment);
     void isNegative(int input, const std::string &comment);
 
+    //!Sets the parameter named \param name (same name as the member, e.g. "n_mob_active") to \param value. Only device and
+    //! solver parameters can be set, not the fitting parameters. Returns false if there is no such parameter, throws
+    //! std::runtime_error if \param value can't be converted.
+    bool set_value(const std::string &name, const std::string &value);
+
+    //!Applies the checks of Initialize to the parameters which set_value can set (e.g. after setting them from a batch file row).
+    //! Throws std::runtime_error for the first invalid one.
+    void check_values();
+
     double N_LUMO, N_HOMO, phi_a, phi_c, eps_active, p_mob_active, n_mob_active;
     double dx, mobil;
     double E_gap, active_CB, active_VB, WF_anode, WF_cathode, N, Nsqrd;
@@ -42,6 +53,27 @@ struct Parameters   //parameters need to be accessble, so all members are public
     int num_cell;
     std::string GenRateFileName;
     double Va_min, Va_max, increment;
+    int solver_method;   //1 = Gummel iterations, 2 = fully coupled Newton
+    int mixing_method;   //1 = linear mixing, 2 = Anderson acceleration (for Gummel iterations)
+    int Anderson_depth;  //# of previous iterations used for Anderson mixing
+    int num_threads;     //# of threads for running several simulations in parallel (e.g. PSO particles), 0 = all hardware threads
+    int details_output;  //V, n, p etc. at each voltage of a single run: 0 = none, 1 = a text file per voltage, 2 = binary file details.snap
+
+    //what of the details is written (see Output_policy)
+    std::string output_voltages;  //all, stride:k, list:Va1,Va2,..., Voc, MPP, combined with +
+    std::string output_fields;    //all, or a comma separated list of V, p, n, J_total, Un, G, R_Langevin (binary details only)
+    std::string output_region;    //all, or a grid index range, e.g. x=10:90 (binary details only)
+    int output_decimation;        //only every output_decimation'th point is written (binary details only)
+    std::string timing_report;    //JSON file with the time of each solver phase per voltage (single runs), "none" = off
+    bool hardware_counters;       //add the hardware counters of each phase to the timing report (see Hw_counters)
+    std::string trace_file;       //Chrome trace event JSON file with cost function evaluations, voltages and iterations, "none" = off
+    int trace_buffer_size;        //# of trace spans and of counters kept per thread (the oldest are overwritten)
+    Output_policy output_policy() const;
+
+    //batch mode: runs all parameter sets of a table instead of a single run or fit
+    std::string batch_file_name;         //table with one parameter set per row, "none" = off
+    std::string batch_output_file_name;  //binary file with the JV curves and convergence stats of all runs
+    bool batch_mode() const {return batch_file_name != "none";}
 
     //optimization (auto fitting) parameters
     bool auto_fit;
@@ -49,16 +81,46 @@ struct Parameters   //parameters need to be accessble, so all members are public
     double fit_tolerance;
     double optim_max_iter;
     std::string exp_data_file_name;
+    int warm_start_cache_size;   //# of converged runs kept to warm start new runs during the fit, 0 = off
     double Photogen_scaling_min, Photogen_scaling_max;
     double n_mob_active_max, n_mob_active_min;
     double p_mob_active_max, p_mob_active_min;
     double k_rec_max, k_rec_min;
 
     bool PSO_Clerc_Kennedy;
+    int PSO_seed;        //seed for the particle random number streams, 0 = seed from the clock
+    bool PSO_async;      //asynchronous PSO: each particle moves as soon as its evaluation is done
+
+    int surrogate_init_points;  //# of initial parameter sets for the surrogate model fit
+    int surrogate_seed;         //seed for the random numbers, 0 = seed from the clock
+
+    int LM_jacobian;     //Levenberg-Marquardt Jacobian: 1 = sensitivity analysis, 2 = finite differences (runs in parallel)
+
+    //multi-fidelity fitting (gradient descent and PSO): candidates are run on a coarse mesh and voltage grid first
+    int MF_mesh_factor;        //the coarse mesh has num_cell/MF_mesh_factor cells (1 and MF_Va_stride == 1: off)
+    int MF_Va_stride;          //the coarse runs only do every MF_Va_stride'th voltage
+    double MF_promote_factor;  //candidates with coarse cost < MF_promote_factor*(cost to beat) are run at full resolution
+    int MF_coarse_iters;       //# of optimizer iterations which use the coarse level, after that all runs are full resolution
+    bool use_multi_fidelity() const {return MF_mesh_factor > 1 || MF_Va_stride > 1;}
+
+    //checkpoints of the optimizer state (gradient descent and PSO), so a killed fit can be continued
+    int checkpoint_interval;       //PSO: # of iterations, GD: # of variable searches between checkpoints, 0 = off
+    std::string checkpoint_file;
+    bool resume;                   //continue from checkpoint_file, if it exists
 
     std::vector<double*> vars;  //will store pointers to the parameters/variables which are optimizing
     std::vector<double> vars_min;  //stores the min of the ranges
     std::vector<double> vars_max;
+
+    //!Returns the values of the fitting variables of this object, in the same order as in vars
+    std::vector<double> get_var_values() const {return {Photogen_scaling, n_mob_active, p_mob_active, k_rec};}
+    void set_var_values(const std::vector<double> &values)
+    {
+        Photogen_scaling = values[0];
+        n_mob_active = values[1];
+        p_mob_active = values[2];
+        k_rec = values[3];
+    }
 };
 
 #endif // PARAMETERS_H
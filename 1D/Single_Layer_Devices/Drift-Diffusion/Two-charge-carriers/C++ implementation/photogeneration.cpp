@@ -4,11 +4,17 @@
 #include "photogeneration.h"
 
 //constructor definition
-Photogeneration::Photogeneration(const Parameters &params, double photogen_scaling, const std::string gen_rate_file_name){
+Photogeneration::Photogeneration(const Parameters &params, double photogen_scaling, const std::string gen_rate_file_name)
+    : Photogeneration(params, photogen_scaling, read_gen_rate(params, gen_rate_file_name))
+{
+     //Using constant generation rate
+     //std::fill(G.begin(), G.end(), G_max);
+}
 
-    PhotogenRate.resize(params.num_cell);
-    PhotogenRate_max = photogen_scaling;
 
+std::vector<double> Photogeneration::read_gen_rate(const Parameters &params, const std::string &gen_rate_file_name){
+
+    std::vector<double> gen_rate(params.num_cell);
     std::ifstream GenRateFile;
 
      GenRateFile.open(gen_rate_file_name);
@@ -19,20 +25,23 @@ Photogeneration::Photogeneration(const Parameters &params, double photogen_scali
      }
 
      for (int i = 1; i <= params.num_cell-1; i++) {
-         GenRateFile >> PhotogenRate[i];
-         //std::cout << "G(i) " << G[i] <<std::endl;
+         GenRateFile >> gen_rate[i];
      }
-     double maxOfGPhotogenRate = *std::max_element(PhotogenRate.begin(),PhotogenRate.end());
+     GenRateFile.close();
 
-     for (int i= 1; i <= params.num_cell-1; i++) {
-         PhotogenRate[i] = PhotogenRate_max*PhotogenRate[i]/maxOfGPhotogenRate;
-         //std::cout << "G(i) " << G[i] <<std::endl;
+     return gen_rate;
+}
 
-         GenRateFile.close();
-     }
 
+Photogeneration::Photogeneration(const Parameters &params, double photogen_scaling, const std::vector<double> &gen_rate){
 
-     //Using constant generation rate
-     //std::fill(G.begin(), G.end(), G_max);
+    PhotogenRate.resize(params.num_cell);
+    PhotogenRate_max = photogen_scaling;
+
+    for (int i = 1; i <= params.num_cell-1; i++)
+        PhotogenRate[i] = gen_rate[i];
+    double maxOfGPhotogenRate = *std::max_element(PhotogenRate.begin(),PhotogenRate.end());
 
+    for (int i= 1; i <= params.num_cell-1; i++)
+        PhotogenRate[i] = PhotogenRate_max*PhotogenRate[i]/maxOfGPhotogenRate;
 }
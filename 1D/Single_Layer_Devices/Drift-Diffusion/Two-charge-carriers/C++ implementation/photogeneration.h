@@ -18,7 +18,14 @@ public:
     //! \param photogen_scaling is the scaling factor obtained from fit to get the correct short-circuit current.
     Photogeneration(const Parameters &params, double photogen_scaling, const std::string gen_rate_file_name);
 
-    std::vector<double> getPhotogenRate() {return PhotogenRate;}
+    //!Same as above, but uses the generation rate profile \param gen_rate (indexed from 1, already read from file) instead of reading the file.
+    Photogeneration(const Parameters &params, double photogen_scaling, const std::vector<double> &gen_rate);
+
+    const std::vector<double> &getPhotogenRate() const {return PhotogenRate;}
+
+    //!Reads the (unscaled) generation rate profile from file \param gen_rate_file_name. Can be used to read the file only once
+    //! when doing many runs (with the constructor which takes the profile).
+    static std::vector<double> read_gen_rate(const Parameters &params, const std::string &gen_rate_file_name);
 private:
     std::vector<double> PhotogenRate;
     double PhotogenRate_max;
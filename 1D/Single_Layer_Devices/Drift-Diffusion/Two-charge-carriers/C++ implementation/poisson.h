@@ -19,10 +19,10 @@ public:
     void set_rhs(const std::vector<double> &n, const std::vector<double> &p, double V_leftBC, double V_rightBC);
 
     //getters
-    std::vector<double> get_main_diag() const {return main_diag;}
-    std::vector<double> get_upper_diag() const {return upper_diag;}
-    std::vector<double> get_lower_diag() const {return lower_diag;}
-    std::vector<double> get_rhs() const {return rhs;}
+    const std::vector<double> &get_main_diag() const {return main_diag;}
+    const std::vector<double> &get_upper_diag() const {return upper_diag;}
+    const std::vector<double> &get_lower_diag() const {return lower_diag;}
+    const std::vector<double> &get_rhs() const {return rhs;}
 
 private:
     std::vector<double> main_diag;
@@ -11,7 +11,7 @@ Recombo:: Recombo(const Parameters &params)      //constructor
     p1 = params.N_HOMO*exp(-(E_trap - params.active_VB)/Vt);
 }
 
-std::vector<double> Recombo::ComputeR_Langevin(const Parameters &params, const std::vector<double> &n, const std::vector<double> &p)
+const std::vector<double> &Recombo::ComputeR_Langevin(const Parameters &params, const std::vector<double> &n, const std::vector<double> &p)
 {
     for (int i = 1; i < p.size(); i++) {
         R_Langevin[i] = k_rec*(params.N*params.N*n[i]*p[i] - n1*p1);
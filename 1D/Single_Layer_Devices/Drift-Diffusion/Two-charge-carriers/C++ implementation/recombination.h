@@ -12,7 +12,8 @@ public:
 
     //!Computes bimolecular Langevin recombination rate.
     //! This depends on the electron \param n and hole \param p density.
-    std::vector<double> ComputeR_Langevin(const Parameters &params, const std::vector<double> &n, const std::vector<double> &p);
+    //! Returns a reference to the internally stored rate (valid until the next call).
+    const std::vector<double> &ComputeR_Langevin(const Parameters &params, const std::vector<double> &n, const std::vector<double> &p);
 
 private:
     double k_rec; //!bimolecular recombination coefficient
@@ -32,19 +32,60 @@
 #include <time.h>
 #include <fstream>
 #include <string>
+#include <memory>
+#include <stdexcept>
+#include <cstdlib>
 
 #include "run_DD.h"
+#include "async_output.h"
+#include "output_policy.h"
+#include "phase_timer.h"
+#include "trace.h"
+
+namespace {
+    //what is written at a voltage. Filled by the solver and written by the output thread.
+    struct Va_output
+    {
+        double Va, J, w, tolerance;
+        int iter;
+        bool write_JV, write_details;
+        Convergence_record convergence;   //written with the JV line
+        std::vector<double> V, p, n, J_total, Un, PhotogenRate, R_Langevin;   //only filled if the details are written
+    };
+}
 
-std::vector<double> run_DD(Parameters &params) {
+DD_result solve_DD(const Parameters &params_in, const DD_options &options) {
 
+    Parameters params = params_in;   //w and tolerance are adjusted during the run, so don't change the caller's parameters
+    Trace_span run_span("solve_DD");
+    const Alloc_counts run_allocs_start = Alloc_tracking::counts();
+    Phase_timers timers;
+    if (!options.timing_report_file_name.empty()) {
+        timers.activate();   //otherwise the TIME_PHASE scopes do nothing
+        if (options.hardware_counters)
+            timers.use_hardware_counters();   //prints why not if they aren't available, then only times
+    }
     const int num_cell = params.num_cell;   //create a local num_cell so don't have to type params.num_cell everywhere
     const double Vbi = params.WF_anode - params.WF_cathode +params.phi_a +params.phi_c;
     const int num_V = static_cast<int>(floor((params.Va_max-params.Va_min)/params.increment))+1;  //floor returns double, explicitely cast to int
     params.tolerance_eq = 100.*params.tolerance_i;
 
     std::ofstream JV;
-    JV.open("JV.txt");  //note: file will be created inside the build directory
-    std::vector<double> J_for_JV;
+    if (options.write_JV)
+        JV.open(options.JV_file_name);  //note: file will be created inside the build directory
+    Utilities utils;
+    std::ofstream convergence;
+    if (options.write_JV && !options.convergence_file_name.empty()) {
+        convergence.open(options.convergence_file_name);
+        utils.write_convergence_header(convergence);
+    }
+    DD_result result;
+    result.total_iterations = 0;
+    result.cost = 0.0;
+    result.aborted = false;
+    result.max_iteration_allocations = {0, 0};
+    result.sensitivities_failed = false;
+    std::vector<double> dJ;
 
     //-------------------------------------------------------------------------------------------------------
     //Construct objects
@@ -52,8 +93,10 @@ std::vector<double> run_DD(Parameters &params) {
     Recombo recombo(params);
     Continuity_p continuity_p(params);
     Continuity_n continuity_n(params);
-    Photogeneration photogen(params, params.Photogen_scaling, params.GenRateFileName);
-    Utilities utils;
+    Photogeneration photogen = options.gen_rate ? Photogeneration(params, params.Photogen_scaling, *options.gen_rate)
+                                                : Photogeneration(params, params.Photogen_scaling, params.GenRateFileName);
+    Newton newton(params);
+    Anderson_mix anderson(2, 1, num_cell-1, params.Anderson_depth);  //mixes n and p together, only used if mixing_method == 2
 
     //Initialize other vectors
     //Will use indicies for n and p... starting from 1 --> since is more natural--> corresponds to 1st node inside the device...
@@ -77,7 +120,68 @@ std::vector<double> run_DD(Parameters &params) {
     }
     V[num_cell] = V_rightBC;
 
-    poisson.setup_matrix();  //outside of loop since matrix never changes
+    Thomas_factor poisson_factor, continuity_n_factor, continuity_p_factor;
+    {
+        TIME_PHASE(Phase::poisson_assembly);
+        poisson.setup_matrix();  //outside of loop since matrix never changes
+    }
+    {
+        TIME_PHASE(Phase::factorization);
+        poisson_factor.factorize(poisson.get_main_diag(), poisson.get_upper_diag(), poisson.get_lower_diag());  //so only need to do back substitution in each iteration
+    }
+
+    //which voltages are written, and for the binary file which fields and points
+    Output_policy policy = params.output_policy();
+    const bool keep_previous = options.write_details && policy.keeps_previous();
+    Va_output previous_output;   //the details of the previous voltage, if keep_previous
+
+    //details of all voltages in one binary file: the interior points of V, p, n, J_total, Un, G and R, in physical units
+    std::unique_ptr<Snapshot_writer> snapshots;
+    const std::vector<uint32_t> full_dims = {static_cast<uint32_t>(num_cell-1)};
+    const Output_region region = policy.select(full_dims, 1);
+    std::vector<int> snapshot_fields;   //indices (as in Va_output) of the fields written
+    std::vector<double> snapshot_scales;
+    std::vector<std::vector<double> > snapshot_buffers;
+    std::vector<const double*> snapshot_values;
+    if (options.write_details && !options.snapshot_file_name.empty()) {
+        const char *names[7] = {"V", "p", "n", "J_total", "Un", "G", "R_Langevin"};
+        const double scales[7] = {Vt, params.N, params.N, 1.0, 1.0, 1.0, 1.0};
+        std::vector<Snapshot_array> arrays;
+        for (int k = 0; k < 7; k++) {
+            if (policy.has_field(names[k])) {
+                arrays.push_back({names[k], region.dims(), region.origin});
+                snapshot_fields.push_back(k);
+                snapshot_scales.push_back(scales[k]);
+            }
+        }
+        snapshot_buffers.resize(arrays.size());
+        snapshot_values.resize(arrays.size());
+        snapshots.reset(new Snapshot_writer(options.snapshot_file_name, arrays, region.spacing));
+    }
+
+    //the JV curve and details are written on a separate thread, while the next voltage is solved
+    std::unique_ptr<Async_output<Va_output> > output;
+    Parameters output_params = params;   //only used by the output thread
+    if (options.write_JV || options.write_details) {
+        output.reset(new Async_output<Va_output>([&](const Va_output &out) {
+            if (out.write_details && snapshots) {
+                const std::vector<double> *fields[7] = {&out.V, &out.p, &out.n, &out.J_total, &out.Un, &out.PhotogenRate, &out.R_Langevin};
+                for (size_t f = 0; f < snapshot_fields.size(); f++) {
+                    region.extract(&(*fields[snapshot_fields[f]])[1], full_dims, snapshot_buffers[f]);
+                    snapshot_values[f] = snapshot_buffers[f].data();
+                }
+                snapshots->write(out.Va, snapshot_values, snapshot_scales);
+            } else if (out.write_details) {
+                output_params.w = out.w;
+                output_params.tolerance = out.tolerance;
+                utils.write_details(output_params, out.Va, out.V, out.p, out.n, out.J_total, out.Un, out.PhotogenRate, out.R_Langevin);
+            }
+            if (out.write_JV) {
+                utils.write_JV(output_params, JV, out.iter, out.Va, out.J);
+                utils.write_convergence(convergence, out.convergence);
+            }
+        }));
+    }
 
     std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();  //start clock timer
 
@@ -108,6 +212,20 @@ std::vector<double> run_DD(Parameters &params) {
             PhotogenRate = photogen.getPhotogenRate();    //otherwise PhotogenRate is pre-initialized to 0 in this main.cpp when declared
         }
         //std::cout << "Va = " << Va <<std::endl;
+        timers.start_voltage(Va);
+        Trace_span Va_span("Va", "Va", Va);
+        std::chrono::steady_clock::time_point Va_start = std::chrono::steady_clock::now();
+        const Alloc_counts Va_allocs_start = Alloc_tracking::counts();
+        Alloc_counts max_iteration_allocs = {0, 0};
+        int w_reductions = 0;
+
+        //start from the initial guess at this voltage, if have one (otherwise from the solution at the previous voltage)
+        if (options.initial_guess && Va_cnt < static_cast<int>(options.initial_guess->V.size())
+                && static_cast<int>(options.initial_guess->V[Va_cnt].size()) == num_cell+1) {
+            V = options.initial_guess->V[Va_cnt];
+            n = options.initial_guess->n[Va_cnt];
+            p = options.initial_guess->p[Va_cnt];
+        }
 
         //Apply the voltage boundary conditions
         V_leftBC = -((Vbi-Va)/(2*Vt) - params.phi_a/Vt);
@@ -117,46 +235,99 @@ std::vector<double> run_DD(Parameters &params) {
 
         error_np = 1.0;
         iter = 0;
+        anderson.reset();  //history from the previous voltage is not useful
+
+        //-----------------Fully coupled Newton solve (if it fails to converge, fall back to Gummel iterations)-------------
+        if (params.solver_method == 2) {
+            p[0] = continuity_p.get_p_leftBC();
+            n[0]  = continuity_n.get_n_leftBC();
+            iter = newton.solve(params, poisson, continuity_n, continuity_p, recombo, PhotogenRate, V_leftBC, V_rightBC, V, n, p);
+            if (iter > 0) {
+                error_np = newton.get_error();   //<= tolerance, so no Gummel iterations are done
+                R_Langevin = recombo.ComputeR_Langevin(params,n,p);
+                for (int i = 1; i < num_cell; i++) {
+                    Un[i] = PhotogenRate[i] - R_Langevin[i];
+                }
+            } else {
+                std::cerr << "Newton did not converge at Va = " << Va << ", using Gummel iterations" << std::endl;
+                iter = 0;
+            }
+        }
+
+        //-----------------Gummel iterations---------------------------------------------------------------------------------
         while (error_np > params.tolerance) {
+            const Alloc_counts iteration_allocs_start = Alloc_tracking::counts();
             //std::cout << "error np " << error_np <<std::endl;
             //std::cout << "Va " << Va <<std::endl;
 
             //-----------------Solve Poisson Equation------------------------------------------------------------------
 
-            poisson.set_rhs(n, p, V_leftBC, V_rightBC);
+            {
+                TIME_PHASE(Phase::poisson_assembly);
+                poisson.set_rhs(n, p, V_leftBC, V_rightBC);
+            }
             oldV = V;
-            newV = Thomas_solve(poisson.get_main_diag(), poisson.get_upper_diag(), poisson.get_lower_diag(), poisson.get_rhs());
+            {
+                TIME_PHASE(Phase::poisson_solve);
+                poisson_factor.solve(poisson.get_rhs(), newV);
+            }
             //add on the BC's --> b/c matrix solver just outputs the insides...
             newV[0] = V[0];
             newV[num_cell] = V[num_cell];
 
             //Mix old and new solutions for V
-            if (iter > 0)
-                V  = utils.linear_mix(params, newV, oldV);
-            else
-                V = newV;
+            //(for Anderson mixing V is not mixed, so that V is a function of n and p only and the Gummel iteration is a fixed point map for n and p)
+            {
+                TIME_PHASE(Phase::mixing);
+                if (iter > 0 && params.mixing_method == 1)
+                    utils.linear_mix(params, newV, oldV, V);
+                else
+                    V = newV;
+            }
             //reset BC's
             V[0] = V_leftBC;
             V[num_cell] = V_rightBC;
 
             //------------------------------Calculate Net Generation Rate----------------------------------------------------------
-
-            R_Langevin = recombo.ComputeR_Langevin(params,n,p);
-            for (int i = 1; i < num_cell; i++) {
-                Un[i] = PhotogenRate[i] - R_Langevin[i];
+            {
+                TIME_PHASE(Phase::continuity_assembly);
+                R_Langevin = recombo.ComputeR_Langevin(params,n,p);
+                for (int i = 1; i < num_cell; i++) {
+                    Un[i] = PhotogenRate[i] - R_Langevin[i];
+                }
+                Up = Un;
             }
-            Up = Un;
 
             //--------------------------------Solve equations for n and p------------------------------------------------------------ 
-
-            continuity_n.setup_eqn(V, Un);
+            {
+                TIME_PHASE(Phase::continuity_assembly);
+                continuity_n.setup_eqn(V, Un);
+            }
             oldn = n;
-            newn = Thomas_solve(continuity_n.get_main_diag(), continuity_n.get_upper_diag(), continuity_n.get_lower_diag(), continuity_n.get_rhs());
+            {
+                TIME_PHASE(Phase::factorization);
+                continuity_n_factor.factorize(continuity_n.get_main_diag(), continuity_n.get_upper_diag(), continuity_n.get_lower_diag());  //matrix changes each iteration
+            }
+            {
+                TIME_PHASE(Phase::solve);
+                continuity_n_factor.solve(continuity_n.get_rhs(), newn);
+            }
 
-            continuity_p.setup_eqn(V, Up);
+            {
+                TIME_PHASE(Phase::continuity_assembly);
+                continuity_p.setup_eqn(V, Up);
+            }
             oldp = p;
-            newp = Thomas_solve(continuity_p.get_main_diag(), continuity_p.get_upper_diag(), continuity_p.get_lower_diag(), continuity_p.get_rhs());
+            {
+                TIME_PHASE(Phase::factorization);
+                continuity_p_factor.factorize(continuity_p.get_main_diag(), continuity_p.get_upper_diag(), continuity_p.get_lower_diag());
+            }
+            {
+                TIME_PHASE(Phase::solve);
+                continuity_p_factor.solve(continuity_p.get_rhs(), newp);
+            }
 
+            TIME_PHASE(Phase::mixing);   //the rest of the iteration
             //if get negative p's or n's set them = 0
             for (int i = 1; i < num_cell; i++) {
                 if (newp[i] < 0.0) newp[i] = 0;
@@ -167,7 +338,7 @@ std::vector<double> run_DD(Parameters &params) {
             old_error = error_np;
             for (int i = 1; i < num_cell; i++) {
                 if (newp[i]!=0 && newn[i] !=0) {
-                    error_np_vector[i] = (abs(newp[i]-oldp[i]) + abs(newn[i]-oldn[i]))/abs(oldp[i]+oldn[i]);
+                    error_np_vector[i] = (std::abs(newp[i]-oldp[i]) + std::abs(newn[i]-oldn[i]))/std::abs(oldp[i]+oldn[i]);
                 }
             }
             error_np = *std::max_element(error_np_vector.begin(),error_np_vector.end());
@@ -179,43 +350,181 @@ std::vector<double> run_DD(Parameters &params) {
             if (not_cnv_cnt > 2000) {
                 params.reduce_w();
                 params.relax_tolerance();
+                w_reductions++;
                 not_cnv_cnt = 0;
+                anderson.reset();  //history was built with the old w
             }
 
-            p = utils.linear_mix(params, newp, oldp);
-            n = utils.linear_mix(params, newn, oldn);
+            if (params.mixing_method == 2) {
+                anderson.set_field(0, newn, oldn);
+                anderson.set_field(1, newp, oldp);
+                anderson.mix(params);
+                anderson.get_result(0, n);
+                anderson.get_result(1, p);
+            } else {
+                utils.linear_mix(params, newp, oldp, p);
+                utils.linear_mix(params, newn, oldn, n);
+            }
             p[0] = continuity_p.get_p_leftBC();
             n[0]  = continuity_n.get_n_leftBC();
 
+            if (Trace::enabled()) {
+                Trace::counter("error_np", error_np);
+                Trace::counter("w", params.w);
+                Trace::counter("tolerance", params.tolerance);
+            }
+
+            //the 1st iteration of a voltage may size buffers, after that the iterations shouldn't allocate
+            const Alloc_counts iteration_allocs = Alloc_tracking::since(iteration_allocs_start);
+            if (iter > 0 && iteration_allocs.allocations > max_iteration_allocs.allocations)
+                max_iteration_allocs = iteration_allocs;
+
             iter = iter+1;
         }
+        Va_span.set_arg("iterations", iter);
+        const double Va_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - Va_start).count();
+        const Alloc_counts Va_allocs = Alloc_tracking::since(Va_allocs_start);
+        if (max_iteration_allocs.allocations > result.max_iteration_allocations.allocations)
+            result.max_iteration_allocations = max_iteration_allocs;
 
         //-------------------Calculate Currents using Scharfetter-Gummel definition--------------------------
         p[0] = continuity_p.get_p_leftBC();
         n[0]  = continuity_n.get_n_leftBC();
+        const std::vector<double> &p_mob = continuity_p.get_p_mob(), &B_p1 = continuity_p.get_B_p1(), &B_p2 = continuity_p.get_B_p2();
+        const std::vector<double> &n_mob = continuity_n.get_n_mob(), &B_n1 = continuity_n.get_B_n1(), &B_n2 = continuity_n.get_B_n2();
         for (int i = 1; i < num_cell; i++) {
-            Jp[i] = -(q*Vt*params.N*params.mobil/params.dx) * continuity_p.get_p_mob()[i] * (p[i]*continuity_p.get_B_p2()[i] - p[i-1]*continuity_p.get_B_p1()[i]);
-            Jn[i] =  (q*Vt*params.N*params.mobil/params.dx) * continuity_n.get_n_mob()[i] * (n[i]*continuity_n.get_B_n1()[i] - n[i-1]*continuity_n.get_B_n2()[i]);
+            Jp[i] = -(q*Vt*params.N*params.mobil/params.dx) * p_mob[i] * (p[i]*B_p2[i] - p[i-1]*B_p1[i]);
+            Jn[i] =  (q*Vt*params.N*params.mobil/params.dx) * n_mob[i] * (n[i]*B_n1[i] - n[i-1]*B_n2[i]);
             J_total[i] = Jp[i] + Jn[i];
         }
 
 
         //---------------------Write to file----------------------------------------------------------------
-        //utils.write_details(params, Va, V, p, n, J_total, Un, PhotogenRate, R_Langevin);
+        result.total_iterations += iter;
+        if (options.save_solutions) {
+            result.solutions.V.push_back(V);
+            result.solutions.n.push_back(n);
+            result.solutions.p.push_back(p);
+        }
         if(Va_cnt >0) {
-            J_for_JV.push_back(J_total[static_cast<int>(floor(params.num_cell/2))]);    //fill a J vector, will be returned by the run_DD function
-            utils.write_JV(params, JV, iter, Va, J_for_JV[Va_cnt-1]); //-1 b/c of the indices filling from 0...
+            result.Va.push_back(Va);
+            result.J.push_back(J_total[static_cast<int>(floor(params.num_cell/2))]);
+            result.iterations.push_back(iter);
+            if (options.save_fields) {
+                result.V.push_back(V);
+                result.n.push_back(n);
+                result.p.push_back(p);
+                result.J_total.push_back(J_total);
+            }
+            if (output) {
+                TIME_PHASE(Phase::output);
+                bool write_previous = false, write_details = false;
+                if (options.write_details)
+                    policy.next_voltage(Va, result.J.back(), write_previous, write_details);
+                auto fill = [&](Va_output &out, bool with_fields) {   //the copies reuse the record's buffers
+                    out.Va = Va;
+                    out.J = result.J.back();
+                    out.w = params.w;
+                    out.tolerance = params.tolerance;
+                    out.iter = iter;
+                    out.write_JV = options.write_JV;
+                    out.write_details = write_details;
+                    out.convergence = {Va, iter, error_np, params.w, params.tolerance, w_reductions, Va_time, Va_allocs, max_iteration_allocs};
+                    if (with_fields) {
+                        out.V = V;
+                        out.p = p;
+                        out.n = n;
+                        out.J_total = J_total;
+                        out.Un = Un;
+                        out.PhotogenRate = PhotogenRate;
+                        out.R_Langevin = R_Langevin;
+                    }
+                };
+
+                if (write_previous) {   //Voc or the MPP was at the previous voltage
+                    Va_output &out = output->acquire();
+                    out = previous_output;
+                    out.write_JV = false;
+                    out.write_details = true;
+                    output->submit();
+                }
+                fill(output->acquire(), write_details);
+                output->submit();
+                if (keep_previous)
+                    fill(previous_output, true);
+            }
+
+            if (options.compute_sensitivities) {
+                if (!newton.sensitivities(params, poisson, continuity_n, continuity_p, recombo, PhotogenRate, V_leftBC, V_rightBC, V, n, p,
+                                          static_cast<int>(floor(params.num_cell/2)), dJ))
+                    result.sensitivities_failed = true;
+                result.dJ_dvars.push_back(dJ);
+            }
+
+            //stop as soon as the cost is known to be larger than max_cost
+            if (options.J_exp && Va_cnt-1 < static_cast<int>(options.J_exp->size())) {
+                double diff = result.J.back() - (*options.J_exp)[Va_cnt-1];
+                result.cost += diff*diff;
+                if (result.cost > options.max_cost) {
+                    result.aborted = true;
+                    break;
+                }
+            }
         }
+        timers.end_voltage(iter);
 
 
     }//end of main loop
-    JV.close();
+    if (output) {
+        TIME_PHASE(Phase::output);
+        output->finish();
+    }
+    if (snapshots)
+        snapshots->close();   //throws if the snapshot file couldn't be written completely
+    if (JV.is_open())
+        JV.close();
+    if (convergence.is_open())
+        convergence.close();
 
 
     std::chrono::high_resolution_clock::time_point finish = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> time = std::chrono::duration_cast<std::chrono::duration<double>>(finish-start);
-    std::cout << "1 DD run CPU time = " << time.count() << std::endl;
+    result.run_time = time.count();
+    result.allocations = Alloc_tracking::since(run_allocs_start);
+    run_span.set_arg("iterations", result.total_iterations);
+    if (!options.timing_report_file_name.empty())
+        timers.write_report(options.timing_report_file_name, "1D", num_cell);
 
-    return J_for_JV;
+    return result;
+
+}
+
+
+std::vector<double> run_DD(const Parameters &params) {
+
+    DD_options options;
+    options.write_JV = true;
+    options.write_details = (params.details_output != 0);
+    if (params.details_output == 2)
+        options.snapshot_file_name = "details.snap";
+    options.convergence_file_name = "convergence.txt";
+    if (params.timing_report != "none")
+        options.timing_report_file_name = params.timing_report;
+    options.hardware_counters = params.hardware_counters;
+    DD_result result;
+    try {
+        result = solve_DD(params, options);
+    }
+    catch (std::runtime_error &e) {   //an output file couldn't be written
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+    std::cout << "1 DD run CPU time = " << result.run_time << std::endl;
+    if (Alloc_tracking::compiled()) {
+        std::cout << "Heap allocations = " << result.allocations.allocations << " (" << result.allocations.bytes << " bytes), at most "
+                  << result.max_iteration_allocations.allocations << " (" << result.max_iteration_allocations.bytes
+                  << " bytes) in a Gummel iteration after the 1st of a voltage" << std::endl;
+    }
 
+    return result.J;
 }
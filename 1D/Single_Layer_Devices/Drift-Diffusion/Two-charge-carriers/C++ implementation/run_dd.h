@@ -18,9 +18,78 @@
 #include "recombination.h"
 #include "photogeneration.h"
 #include "thomas_tridiag_solve.h"
+#include "newton.h"
+#include "anderson_mix.h"
 #include "Utilities.h"
+#include "snapshot_file.h"
 
-std::vector<double> run_DD(Parameters &params);
+//!Converged V, n and p at each voltage of a run (index 0 is the equilibrium run). Can be used as the initial guess for another run.
+struct DD_solutions
+{
+    std::vector<std::vector<double> > V, n, p;
+};
+
+//!Options for a single drift-diffusion run (i.e. one JV curve). By default nothing is written to files.
+struct DD_options
+{
+    DD_options() : write_JV(false), JV_file_name("JV.txt"), write_details(false), hardware_counters(false), save_fields(false), save_solutions(false),
+                   gen_rate(nullptr), initial_guess(nullptr), J_exp(nullptr), max_cost(1e300), compute_sensitivities(false) {}
+
+    bool write_JV;              //write the JV curve to JV_file_name
+    std::string JV_file_name;
+    std::string convergence_file_name;  //if not empty (and write_JV), the convergence of each voltage is written to this file (see Convergence_record)
+    bool write_details;         //write V, n, p, etc. at each voltage to a file named by the voltage
+    std::string snapshot_file_name;  //if not empty, the details of all voltages are written to this binary snapshot file instead
+    std::string timing_report_file_name;  //if not empty, the time spent in each solver phase is written to this JSON file (see Phase_timers)
+    bool hardware_counters;     //also count the hardware counters of each phase in the timing report, if available
+    bool save_fields;           //store V, n, p, J_total at each voltage in the DD_result
+    bool save_solutions;        //store V, n, p at each voltage (incl. equilibrium) in DD_result::solutions, for warm starting other runs
+    const std::vector<double> *gen_rate;  //if not null, this (unscaled) generation rate profile is used instead of reading params.GenRateFileName
+    const DD_solutions *initial_guess;    //if not null, the iterations at each voltage start from these solutions (e.g. from a run with similar parameters)
+
+    //for fitting: if J_exp is not null, the least squares difference to J_exp is accumulated during the sweep,
+    //and the run stops as soon as it exceeds max_cost (since then the parameters are already known to be worse)
+    const std::vector<double> *J_exp;
+    double max_cost;
+
+    //find the derivatives of J (and of the cost, if J_exp is given) wrt. the fitting variables by forward sensitivity analysis.
+    //Costs one block tridiagonal solve per variable per voltage.
+    bool compute_sensitivities;
+};
+
+//!Results of a drift-diffusion run. The vectors are indexed by voltage (the equilibrium run is not included).
+struct DD_result
+{
+    std::vector<double> Va;           //applied voltages
+    std::vector<double> J;            //total current at each voltage (in the middle of the device)
+    std::vector<int> iterations;      //# of iterations needed to converge at each voltage
+    int total_iterations;             //incl. the equilibrium run
+    double run_time;                  //wall time in s
+    Alloc_counts allocations;                 //heap allocations of the run (only counted with DD_TRACK_ALLOCATIONS, see Alloc_tracking)
+    Alloc_counts max_iteration_allocations;   //most allocations of a Gummel iteration after the 1st of a voltage (the steady state)
+
+    double cost;                      //least squares difference to DD_options::J_exp (of the voltages done)
+    bool aborted;                     //true if the run was stopped because the cost exceeded DD_options::max_cost
+
+    //only filled if DD_options::compute_sensitivities is set. The variables are in the same order as in Parameters::vars
+    //(Photogen_scaling, n_mob_active, p_mob_active, k_rec)
+    std::vector<std::vector<double> > dJ_dvars;   //dJ/dvar at each voltage
+    bool sensitivities_failed;                    //true if the sensitivities couldn't be computed at some voltage (its dJ_dvars are 0)
+
+    //only filled if DD_options::save_fields is set
+    std::vector<std::vector<double> > V, n, p, J_total;
+
+    DD_solutions solutions;  //only filled if DD_options::save_solutions is set
+};
+
+//!Solves the drift-diffusion equations for all voltages from params.Va_min to params.Va_max.
+//! This is reentrant: all state is local to the call, \param params is not changed (a local copy is used for the
+//! adjusted w and tolerance), and files are only read/written as requested in \param options.
+//! So several runs can be done in parallel threads.
+DD_result solve_DD(const Parameters &params, const DD_options &options = DD_options());
+
+//!Runs solve_DD, writes the JV curve to JV.txt, the convergence of each voltage to convergence.txt and prints the run time. Returns the current at each voltage.
+std::vector<double> run_DD(const Parameters &params);
 
 
 
@@ -0,0 +1,80 @@
+#include "solution_cache.h"
+
+#include <cmath>
+
+Solution_cache::Solution_cache(const Parameters &params, int capacity) : capacity(capacity), vars_min(params.vars_min), vars_max(params.vars_max)
+{
+}
+
+
+std::vector<double> normalized_var_values(const Parameters &params, const std::vector<double> &vars_min, const std::vector<double> &vars_max)
+{
+    std::vector<double> values = params.get_var_values();
+    std::vector<double> result(vars_min.size());
+
+    for (size_t i = 0; i < vars_min.size(); i++) {
+        if (vars_min[i] > 0)
+            result[i] = log(values[i]/vars_min[i])/log(vars_max[i]/vars_min[i]);
+        else
+            result[i] = (values[i] - vars_min[i])/(vars_max[i] - vars_min[i]);
+    }
+
+    return result;
+}
+
+
+std::vector<double> Solution_cache::key(const Parameters &params) const
+{
+    return normalized_var_values(params, vars_min, vars_max);
+}
+
+
+std::shared_ptr<const DD_solutions> Solution_cache::find_nearest(const std::vector<double> &key) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::shared_ptr<const DD_solutions> nearest;
+    double min_dist = max_distance*max_distance;
+    for (size_t e = 0; e < entries.size(); e++) {
+        double dist = 0.0;
+        for (size_t i = 0; i < key.size(); i++)
+            dist += (key[i] - entries[e].key[i])*(key[i] - entries[e].key[i]);
+        if (dist < min_dist) {
+            min_dist = dist;
+            nearest = entries[e].solutions;
+        }
+    }
+
+    return nearest;
+}
+
+
+void Solution_cache::insert(const std::vector<double> &key, DD_solutions &&solutions)
+{
+    Entry entry;
+    entry.key = key;
+    entry.solutions = std::make_shared<const DD_solutions>(std::move(solutions));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back(entry);
+    while (static_cast<int>(entries.size()) > capacity)
+        entries.pop_front();
+}
+
+
+DD_result solve_DD_cached(const Parameters &params, DD_options options, Solution_cache *cache)
+{
+    if (!cache)
+        return solve_DD(params, options);
+
+    std::vector<double> key = cache->key(params);
+    std::shared_ptr<const DD_solutions> guess = cache->find_nearest(key);  //keeps the solution alive, even if it is removed from the cache
+    options.initial_guess = guess.get();
+    options.save_solutions = true;
+
+    DD_result result = solve_DD(params, options);
+    if (!result.aborted)   //incomplete runs are not much use for warm starts
+        cache->insert(key, std::move(result.solutions));
+
+    return result;
+}
@@ -0,0 +1,54 @@
+#ifndef SOLUTION_CACHE_H
+#define SOLUTION_CACHE_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "parameters.h"
+#include "run_DD.h"
+
+//!Returns the fitting variables of \param params, normalized to [0,1] within the ranges \param vars_min to \param vars_max
+//! (logarithmically for positive ranges). Used as the key of parameter sets by Solution_cache and Multi_fidelity.
+std::vector<double> normalized_var_values(const Parameters &params, const std::vector<double> &vars_min, const std::vector<double> &vars_max);
+
+//!Cache of converged solutions of previous runs, used to warm start the runs of the optimizers.
+//! The solutions are keyed by the values of the fitting variables, normalized to [0,1] (logarithmically for positive ranges).
+//! A new run starts at each voltage from the solution of the nearest cached run, so when the optimizer only makes a small
+//! change to the parameters, few iterations are needed. Thread safe.
+class Solution_cache
+{
+public:
+    //!\param params gives the ranges of the fitting variables, \param capacity is the max # of runs kept (oldest are removed first).
+    Solution_cache(const Parameters &params, int capacity);
+
+    //!Returns the normalized key for the fitting variables of \param params
+    std::vector<double> key(const Parameters &params) const;
+
+    //!Returns the solutions of the cached run nearest to \param key, or null if there is none within max_distance.
+    //! (Starting from a run with quite different parameters needs more iterations than starting each voltage from the previous one.)
+    std::shared_ptr<const DD_solutions> find_nearest(const std::vector<double> &key) const;
+
+    void insert(const std::vector<double> &key, DD_solutions &&solutions);
+
+private:
+    struct Entry
+    {
+        std::vector<double> key;
+        std::shared_ptr<const DD_solutions> solutions;
+    };
+
+    static constexpr double max_distance = 0.05;  //in normalized units, i.e. 5% of the (log) range of a variable
+
+    int capacity;
+    std::vector<double> vars_min, vars_max;
+    std::deque<Entry> entries;
+    mutable std::mutex mutex;
+};
+
+//!Runs solve_DD for \param params with \param options, starting from the nearest solution in \param cache and storing the new
+//! solution in the cache (so the returned result has no solutions). If \param cache is null, just runs solve_DD.
+DD_result solve_DD_cached(const Parameters &params, DD_options options, Solution_cache *cache);
+
+#endif // SOLUTION_CACHE_H
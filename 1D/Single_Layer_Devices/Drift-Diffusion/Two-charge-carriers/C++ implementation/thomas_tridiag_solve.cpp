@@ -1,6 +1,8 @@
 #include <vector>
 #include <iostream>
 
+#include "thomas_tridiag_solve.h"
+
 //!This function uses Thomas algorithm for tridiagonal matrix (special case of Gaussian elimination)
 //! diagonal = array containing elements of main diagonal. indices: (a1.....an)
 //! b = array containing elements of upper diagonal. indices (b1....b_n-1)
@@ -29,3 +31,31 @@ for (int i = num_elements; i > 1; i--)
 
 return x;
 }
+
+
+void Thomas_factor::factorize(const std::vector<double> &a, const std::vector<double> &b, const std::vector<double> &c)
+{
+    num_elements = a.size()-1;
+    multiplier.resize(num_elements+1);
+    pivot = a;
+    upper = b;
+
+    for (int i = 2; i <= num_elements; i++) {
+        multiplier[i] = c[i-1]/pivot[i-1];
+        pivot[i] -= multiplier[i]*b[i-1];
+    }
+}
+
+
+void Thomas_factor::solve(const std::vector<double> &rhs, std::vector<double> &x) const
+{
+    //Forward substitution (x is used to store the eliminated rhs)
+    x[1] = rhs[1];
+    for (int i = 2; i <= num_elements; i++)
+        x[i] = rhs[i] - multiplier[i]*x[i-1];
+
+    //Backward substitution
+    x[num_elements] = x[num_elements]/pivot[num_elements];
+    for (int i = num_elements; i > 1; i--)
+        x[i-1] = (x[i-1] - x[i]*upper[i-1])/pivot[i-1];
+}
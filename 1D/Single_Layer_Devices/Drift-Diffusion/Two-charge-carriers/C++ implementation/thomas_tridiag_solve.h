@@ -10,5 +10,28 @@
 std::vector<double> Thomas_solve(const std::vector<double> &a, const std::vector<double> &b,const std::vector<double> &c, std::vector<double> &rhs);
 
 
+//!Thomas algorithm for a tridiagonal matrix which stays the same for many solves (i.e. the Poisson matrix).
+//! The forward elimination of the matrix is done once in factorize(), which stores the multipliers and pivots,
+//! so each solve() only does the forward and back substitution of the rhs.
+//! Indexing of the diagonals is the same as for Thomas_solve.
+class Thomas_factor
+{
+public:
+    Thomas_factor() : num_elements(0) {}
+
+    //!Factorizes the matrix with main diagonal \param a, upper diagonal \param b and lower diagonal \param c.
+    void factorize(const std::vector<double> &a, const std::vector<double> &b, const std::vector<double> &c);
+
+    //!Solves A*x = \param rhs using the stored factorization and writes the solution into indices 1...n of \param x.
+    //! x must be allocated by the caller (size at least n+1), so no memory is allocated here. rhs is not changed.
+    void solve(const std::vector<double> &rhs, std::vector<double> &x) const;
+
+private:
+    int num_elements;
+    std::vector<double> multiplier;  //c_i-1/diagonal_i-1 used in the forward elimination
+    std::vector<double> pivot;       //main diagonal after the forward elimination
+    std::vector<double> upper;       //b
+};
+
 
 #endif // THOMAS_TRIDIAG_SOLVE_H
@@ -0,0 +1,166 @@
+#include "thread_pool.h"
+
+Thread_pool::Thread_pool(int num_threads) : current_task(nullptr), next_task(0), total_tasks(0), done_tasks(0), stop(false)
+{
+    if (num_threads <= 0)
+        num_threads = hardware_threads();
+
+    for (int i = 0; i < num_threads; i++)
+        workers.push_back(std::thread(&Thread_pool::worker_loop, this));
+}
+
+
+Thread_pool::~Thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    work_cv.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+
+int Thread_pool::hardware_threads()
+{
+    int n = static_cast<int>(std::thread::hardware_concurrency());  //returns 0 if not known
+    return (n > 0) ? n : 1;
+}
+
+
+void Thread_pool::parallel_for(int num_tasks, const std::function<void(int)> &task)
+{
+    if (num_tasks <= 0) return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    current_task = &task;
+    next_task = 0;
+    total_tasks = num_tasks;
+    done_tasks = 0;
+    error = nullptr;
+    work_cv.notify_all();
+
+    done_cv.wait(lock, [this]{return done_tasks == total_tasks;});
+    current_task = nullptr;
+    total_tasks = 0;
+    next_task = 0;
+
+    if (error) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+
+void Thread_pool::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work_cv.wait(lock, [this]{return stop || next_task < total_tasks;});
+        if (stop) return;
+
+        int i = next_task++;
+        const std::function<void(int)> *task = current_task;
+        lock.unlock();
+        try {
+            (*task)(i);
+        }
+        catch (...) {
+            lock.lock();
+            if (!error) error = std::current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+
+        done_tasks++;
+        if (done_tasks == total_tasks)
+            done_cv.notify_all();
+    }
+}
+
+
+namespace {
+    struct Task_queue
+    {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+}
+
+void Thread_pool::run_work_stealing(const std::vector<int> &task_ids, const std::function<bool(int)> &task)
+{
+    const int num_queues = size();
+    std::vector<Task_queue> queues(num_queues);
+    for (size_t i = 0; i < task_ids.size(); i++)
+        queues[i % num_queues].tasks.push_back(task_ids[i]);
+
+    int outstanding = static_cast<int>(task_ids.size());  //# of tasks queued or running
+    std::atomic<int> queued(outstanding);
+    std::atomic<bool> abort(false);
+    std::mutex idle_mutex;   //protects outstanding, used to let idle threads wait for new tasks
+    std::condition_variable idle_cv;
+
+    parallel_for(num_queues, [&](int q) {
+        while (!abort) {
+            //own queue first (newest task), then steal the oldest task from the others
+            int id = -1;
+            for (int k = 0; k < num_queues && id < 0; k++) {
+                Task_queue &queue = queues[(q + k) % num_queues];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty()) {
+                    if (k == 0) {
+                        id = queue.tasks.back();
+                        queue.tasks.pop_back();
+                    } else {
+                        id = queue.tasks.front();
+                        queue.tasks.pop_front();
+                    }
+                    queued--;
+                }
+            }
+            if (id < 0) {
+                //all queues empty: wait until a running task is queued again or all are done
+                std::unique_lock<std::mutex> lock(idle_mutex);
+                idle_cv.wait(lock, [&]{return queued > 0 || outstanding == 0 || abort;});
+                if (outstanding == 0) return;
+                continue;
+            }
+
+            bool requeue;
+            try {
+                requeue = task(id);
+            }
+            catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(idle_mutex);
+                    abort = true;
+                }
+                idle_cv.notify_all();
+                throw;  //rethrown by parallel_for
+            }
+
+            if (requeue) {
+                {
+                    //at the oldest end, so the other tasks of this queue run before it again
+                    std::lock_guard<std::mutex> lock(queues[q].mutex);
+                    queues[q].tasks.push_front(id);
+                }
+                {
+                    std::lock_guard<std::mutex> lock(idle_mutex);
+                    queued++;
+                }
+                idle_cv.notify_one();
+            } else {
+                bool all_done;
+                {
+                    std::lock_guard<std::mutex> lock(idle_mutex);
+                    outstanding--;
+                    all_done = (outstanding == 0);
+                }
+                if (all_done) idle_cv.notify_all();
+            }
+        }
+    });
+}
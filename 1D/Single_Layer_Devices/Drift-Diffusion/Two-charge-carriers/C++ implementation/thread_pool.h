@@ -0,0 +1,52 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <deque>
+#include <atomic>
+
+//!Fixed size pool of worker threads, used to run independent drift-diffusion simulations in parallel
+//! (e.g. evaluating all particles of a particle swarm iteration). The threads are started once and reused.
+class Thread_pool
+{
+public:
+    //!Starts \param num_threads worker threads. If num_threads <= 0, the # of hardware threads is used.
+    explicit Thread_pool(int num_threads);
+    ~Thread_pool();
+
+    int size() const {return static_cast<int>(workers.size());}
+
+    //!Calls \param task(i) for i = 0 to \param num_tasks-1 on the worker threads and waits until all are done.
+    //! If a task throws, the first exception is rethrown here (after all tasks finished).
+    //! Should only be called from one thread at a time.
+    void parallel_for(int num_tasks, const std::function<void(int)> &task);
+
+    //!Runs tasks which can be queued again, using one task queue per thread with work stealing: each thread takes the newest
+    //! task from its own queue, and if that is empty it steals the oldest task from another thread's queue.
+    //! \param task(id) is called for each queued task id and returns true if the task should be queued again (on the same thread,
+    //! behind its other tasks, so the tasks of a queue take turns).
+    //! The tasks \param task_ids are initially distributed round robin. Returns when no task is queued or running.
+    void run_work_stealing(const std::vector<int> &task_ids, const std::function<bool(int)> &task);
+
+    //!Returns the # of hardware threads (at least 1)
+    static int hardware_threads();
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_cv, done_cv;
+
+    const std::function<void(int)> *current_task;
+    int next_task, total_tasks, done_tasks;
+    std::exception_ptr error;
+    bool stop;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,13 @@
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+CONFIG -= qt
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    snapshot_to_text.cpp \
+    ../snapshot_file.cpp
+
+HEADERS += \
+    ../snapshot_file.h
@@ -0,0 +1,180 @@
+#include "trace.h"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+namespace {
+    struct Event
+    {
+        const char *name;
+        const char *arg_names[2];
+        double args[2];
+        int num_args;
+        bool is_counter;
+        int64_t start_ns, end_ns;   //end_ns is not used for counters
+    };
+
+    struct Ring
+    {
+        std::vector<Event> events;
+        uint64_t num_recorded;   //incl. the overwritten events; the next event goes to events[num_recorded % size]
+
+        void record(const Event &event)
+        {
+            events[num_recorded % events.size()] = event;
+            num_recorded++;
+        }
+    };
+
+    //the ring buffers of one thread. Only that thread writes to them. The counters (several per iteration) have their own
+    //ring, so they don't overwrite the much fewer spans (e.g. of the cost function evaluations).
+    struct Thread_buffer
+    {
+        int tid;
+        Ring spans, counters;
+    };
+
+    std::atomic<bool> trace_enabled(false);
+    std::chrono::steady_clock::time_point trace_start;
+    size_t buffer_size = 0;
+    std::mutex buffers_mutex;   //only locked when a thread records its first event, and by write()
+    std::vector<std::unique_ptr<Thread_buffer> > buffers;   //kept after their thread ends
+    thread_local Thread_buffer *thread_buffer = nullptr;
+
+    Thread_buffer &this_thread_buffer()
+    {
+        if (!thread_buffer) {
+            std::lock_guard<std::mutex> lock(buffers_mutex);
+            buffers.emplace_back(new Thread_buffer{static_cast<int>(buffers.size()), {std::vector<Event>(buffer_size), 0},
+                                                   {std::vector<Event>(buffer_size), 0}});
+            thread_buffer = buffers.back().get();
+        }
+        return *thread_buffer;
+    }
+
+    //writes a JSON string (the names are literals from the code, so only " and \ need escaping)
+    void write_string(std::ofstream &file, const char *text)
+    {
+        file << '"';
+        for (const char *c = text; *c; c++) {
+            if (*c == '"' || *c == '\\')
+                file << '\\';
+            file << *c;
+        }
+        file << '"';
+    }
+
+    void write_number(std::ofstream &file, double value)
+    {
+        if (std::isfinite(value))
+            file << value;
+        else
+            file << "null";
+    }
+
+    //writes the events of \param ring, oldest first, and returns the # of overwritten events. The timestamps are in us.
+    uint64_t write_ring(std::ofstream &file, const Ring &ring, int tid)
+    {
+        const uint64_t size = ring.events.size();
+        const uint64_t begin = (ring.num_recorded > size) ? ring.num_recorded - size : 0;
+        for (uint64_t k = begin; k < ring.num_recorded; k++) {
+            const Event &event = ring.events[k % size];
+            file << ",\n{\"name\": ";
+            write_string(file, event.name);
+            if (event.is_counter)
+                file << ", \"ph\": \"C\", \"id\": " << tid;
+            else
+                file << ", \"ph\": \"X\", \"dur\": " << 1e-3*(event.end_ns - event.start_ns);
+            file << ", \"ts\": " << 1e-3*event.start_ns << ", \"pid\": 1, \"tid\": " << tid << ", \"args\": {";
+            for (int i = 0; i < event.num_args; i++) {
+                file << (i ? ", " : "");
+                write_string(file, event.arg_names[i]);
+                file << ": ";
+                write_number(file, event.args[i]);
+            }
+            file << "}}";
+        }
+        return begin;
+    }
+}
+
+
+void Trace::start(int events_per_thread)
+{
+    buffer_size = static_cast<size_t>(events_per_thread > 0 ? events_per_thread : 1);
+    trace_start = std::chrono::steady_clock::now();
+    trace_enabled.store(true, std::memory_order_release);
+}
+
+
+bool Trace::enabled()
+{
+    return trace_enabled.load(std::memory_order_relaxed);
+}
+
+
+int64_t Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_start).count();
+}
+
+
+void Trace::counter(const char *name, double value)
+{
+    if (!enabled())
+        return;
+    Event event = {name, {name, nullptr}, {value, 0.0}, 1, true, now(), 0};
+    this_thread_buffer().counters.record(event);
+}
+
+
+void Trace::span(const char *name, int64_t start_ns, int64_t end_ns, const char *const arg_names[], const double args[], int num_args)
+{
+    if (!enabled())
+        return;
+    Event event = {name, {nullptr, nullptr}, {0.0, 0.0}, num_args, false, start_ns, end_ns};
+    for (int i = 0; i < num_args && i < 2; i++) {
+        event.arg_names[i] = arg_names[i];
+        event.args[i] = args[i];
+    }
+    this_thread_buffer().spans.record(event);
+}
+
+
+bool Trace::write(const std::string &file_name)
+{
+    std::ofstream file(file_name);
+    if (!file) {
+        std::cerr << "Unable to open trace file " << file_name << std::endl;
+        return false;
+    }
+    file << std::setprecision(12);
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    uint64_t overwritten = 0;
+    bool first = true;
+    file << "{\"traceEvents\": [";
+    for (size_t b = 0; b < buffers.size(); b++) {
+        const Thread_buffer &buffer = *buffers[b];
+        file << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer.tid
+             << ", \"args\": {\"name\": \"thread " << buffer.tid << "\"}}";
+        first = false;
+
+        overwritten += write_ring(file, buffer.spans, buffer.tid);
+        overwritten += write_ring(file, buffer.counters, buffer.tid);
+    }
+    file << "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"overwritten_events\": " << overwritten << "}}\n";
+
+    if (!file) {
+        std::cerr << "Unable to write trace file " << file_name << std::endl;
+        return false;
+    }
+    return true;
+}
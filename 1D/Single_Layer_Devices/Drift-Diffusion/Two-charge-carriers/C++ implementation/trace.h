@@ -0,0 +1,76 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <cstdint>
+
+//!Records spans (e.g. a cost function evaluation, the iterations at one voltage) and counters (e.g. the error of each Gummel
+//! iteration) and writes them as Chrome trace event JSON, which can be opened in chrome://tracing or ui.perfetto.dev.
+//! Each thread records into its own ring buffers, so recording needs no locks and works with the parallel evaluations of the
+//! optimizers. If a buffer is full the oldest events of that thread are overwritten; spans and counters have separate buffers,
+//! so the many counters don't overwrite the spans. Names must be string literals (only the pointers are stored).
+//! If tracing isn't started, recording only checks a flag.
+class Trace
+{
+public:
+    //!Starts recording, with ring buffers of \param events_per_thread spans and as many counters per thread.
+    //! Call once, before any threads are started.
+    static void start(int events_per_thread);
+
+    static bool enabled();
+
+    //!Records the counter \param name = \param value (a separate counter track per thread)
+    static void counter(const char *name, double value);
+
+    //!Writes all recorded events to \param file_name. No thread may record at the same time (call it after the parallel work).
+    //! Prints an error and returns false if the file can't be written.
+    static bool write(const std::string &file_name);
+
+    //!Records a finished span. Used by Trace_span.
+    static void span(const char *name, int64_t start_ns, int64_t end_ns, const char *const arg_names[], const double args[], int num_args);
+
+    //!Time since start() in ns
+    static int64_t now();
+};
+
+
+//!Records the time from construction to destruction as a span named \param name, with up to 2 numeric arguments
+//! (e.g. the voltage), which can also be set later with set_arg (e.g. the # of iterations).
+class Trace_span
+{
+public:
+    explicit Trace_span(const char *name) : name(name), num_args(0), start_ns(Trace::enabled() ? Trace::now() : -1) {}
+    Trace_span(const char *name, const char *arg_name, double arg) : Trace_span(name) {set_arg(arg_name, arg);}
+    ~Trace_span()
+    {
+        if (start_ns >= 0)
+            Trace::span(name, start_ns, Trace::now(), arg_names, args, num_args);
+    }
+
+    //!Sets argument \param arg_name to \param value (the 3rd and following arguments are ignored)
+    void set_arg(const char *arg_name, double value)
+    {
+        for (int i = 0; i < num_args; i++) {
+            if (arg_names[i] == arg_name) {
+                args[i] = value;
+                return;
+            }
+        }
+        if (num_args < 2) {
+            arg_names[num_args] = arg_name;
+            args[num_args++] = value;
+        }
+    }
+
+private:
+    const char *name;
+    const char *arg_names[2];
+    double args[2];
+    int num_args;
+    int64_t start_ns;   //-1 if tracing is off
+
+    Trace_span(const Trace_span&);
+    Trace_span &operator=(const Trace_span&);
+};
+
+#endif // TRACE_H
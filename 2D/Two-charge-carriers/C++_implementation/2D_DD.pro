@@ -1,9 +1,10 @@
 TEMPLATE = app
-CONFIG += console c++11
+CONFIG += console c++11 thread
 CONFIG -= app_bundle
 CONFIG -= qt
 
 QMAKE_CXXFLAGS += -openmp
+#DEFINES += DD_NO_TIMERS  #compiles out the phase timers of timing_report (see phase_timer.h)
 
 INCLUDEPATH += C:/Eigen
 DEPENDPATH += C:/Eigen
@@ -15,7 +16,13 @@ SOURCES += main.cpp \
     photogeneration.cpp \
     poisson.cpp \
     recombination.cpp \
-    Utilities.cpp
+    Utilities.cpp \
+    anderson_mix.cpp \
+    snapshot_file.cpp \
+    vti_file.cpp \
+    output_policy.cpp \
+    phase_timer.cpp \
+    hw_counters.cpp
 
 HEADERS += \
     constants.h \
@@ -25,4 +32,11 @@ HEADERS += \
     photogeneration.h \
     poisson.h \
     recombination.h \
-    Utilities.h
+    Utilities.h \
+    anderson_mix.h \
+    snapshot_file.h \
+    async_output.h \
+    vti_file.h \
+    output_policy.h \
+    phase_timer.h \
+    hw_counters.h
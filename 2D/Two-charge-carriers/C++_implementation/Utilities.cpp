@@ -5,15 +5,11 @@ Utilities::Utilities()
 {
 }
 
-std::vector<double> Utilities::linear_mix(const Parameters &params, const std::vector<double> &new_values,const std::vector<double> &old_values)
+void Utilities::linear_mix(const Parameters &params, const std::vector<double> &new_values, const std::vector<double> &old_values, std::vector<double> &result)
 {
-    static std::vector<double> result(params.num_elements+1);  //static so only allocate at 1st fnc call
-
     for (int i = 1; i <= params.num_elements; i++) {  //note: all the changing values in vectors start from 1 (0th index is a BC)
         result[i] = new_values[i]*params.w + old_values[i]*(1.0 - params.w);
     }
-
-    return result;
 }
 
 
@@ -47,3 +43,17 @@ void Utilities::write_JV(const Parameters &params, std::ofstream &JV, double ite
         JV << Va << " " << J_total_Z(i,i) << " " << iter << "\n";
     }
 }
+
+void Utilities::write_convergence_header(std::ofstream &file)
+{
+    if (file.is_open())
+        file << "#Va iterations error w tolerance w_reductions time\n";
+}
+
+void Utilities::write_convergence(std::ofstream &file, const Convergence_record &record)
+{
+    if (file.is_open()) {
+        file << record.Va << " " << record.iterations << " " << record.error << " " << record.w << " " << record.tolerance
+             << " " << record.w_reductions << " " << record.time << "\n";
+    }
+}
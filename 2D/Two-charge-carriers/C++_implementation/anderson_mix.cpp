@@ -0,0 +1,121 @@
+#include "anderson_mix.h"
+
+#include <cmath>
+
+Anderson_mix::Anderson_mix(int num_fields, int first_index, int last_index, int depth) : first(first_index), depth(depth)
+{
+    length = last_index - first_index + 1;
+    size = num_fields*length;
+
+    x.resize(size);
+    f.resize(size);
+    weight.resize(size);
+    result.resize(size);
+    dX.resize(depth, std::vector<double>(size));
+    dF.resize(depth, std::vector<double>(size));
+    last_x.resize(size);
+    last_f.resize(size);
+    Q.resize(depth, std::vector<double>(size));
+    R.resize(depth*depth);
+    gamma.resize(depth);
+    column.resize(depth);
+
+    newest = -1;
+    reset();
+}
+
+
+void Anderson_mix::set_field(int field, const std::vector<double> &new_values, const std::vector<double> &old_values)
+{
+    int offset = field*length - first;
+    for (int i = first; i < first + length; i++) {
+        x[offset+i] = old_values[i];
+        f[offset+i] = new_values[i] - old_values[i];
+        weight[offset+i] = 1.0/std::abs(old_values[i]);  //densities vary over many orders of magnitude, so use the relative residual
+    }
+}
+
+
+void Anderson_mix::mix(const Parameters &params)
+{
+    const double w = params.w;
+
+    //store the differences to the previous iteration in the ring buffer
+    if (have_last && depth > 0) {
+        newest = (newest + 1) % depth;
+        for (int i = 0; i < size; i++) {
+            dX[newest][i] = x[i] - last_x[i];
+            dF[newest][i] = f[i] - last_f[i];
+        }
+        if (num_stored < depth) num_stored++;
+    }
+    last_x = x;
+    last_f = f;
+    have_last = true;
+
+    int m = solve_least_squares();
+
+    //x_new = x + w*f - (dX + w*dF)*gamma
+    for (int i = 0; i < size; i++) {
+        double linear = x[i] + w*f[i];
+        double value = linear;
+        for (int j = 0; j < m; j++)
+            value -= gamma[j]*(dX[column[j]][i] + w*dF[column[j]][i]);
+        result[i] = (value > 0.0) ? value : linear;  //keep the densities positive
+    }
+}
+
+
+void Anderson_mix::get_result(int field, std::vector<double> &values) const
+{
+    int offset = field*length - first;
+    for (int i = first; i < first + length; i++)
+        values[i] = result[offset+i];
+}
+
+
+int Anderson_mix::solve_least_squares()
+{
+    const double drop_tol = 1e-8;  //relative size of the part of a column which is not in the span of the newer columns
+    int m = 0;
+
+    //newest history entries first, so the oldest ones are dropped if the columns are linearly dependent
+    for (int j = 0; j < num_stored; j++) {
+        int idx = (newest - j + depth) % depth;
+        std::vector<double> &q = Q[m];
+        double norm_before = 0.0;
+        for (int i = 0; i < size; i++) {
+            q[i] = weight[i]*dF[idx][i];
+            norm_before += q[i]*q[i];
+        }
+        for (int k = 0; k < m; k++) {
+            double dot = 0.0;
+            for (int i = 0; i < size; i++) dot += Q[k][i]*q[i];
+            R[k*depth + m] = dot;
+            for (int i = 0; i < size; i++) q[i] -= dot*Q[k][i];
+        }
+        double norm = 0.0;
+        for (int i = 0; i < size; i++) norm += q[i]*q[i];
+        if (!std::isfinite(norm) || norm == 0.0 || norm <= drop_tol*drop_tol*norm_before)
+            continue;   //drop this column
+
+        norm = sqrt(norm);
+        R[m*depth + m] = norm;
+        for (int i = 0; i < size; i++) q[i] /= norm;
+        column[m] = idx;
+        m++;
+    }
+
+    //gamma = R^-1 * Q^T * W*f
+    for (int k = 0; k < m; k++) {
+        double dot = 0.0;
+        for (int i = 0; i < size; i++) dot += Q[k][i]*weight[i]*f[i];
+        gamma[k] = dot;
+    }
+    for (int row = m-1; row >= 0; row--) {
+        for (int k = row+1; k < m; k++) gamma[row] -= R[row*depth + k]*gamma[k];
+        gamma[row] /= R[row*depth + row];
+    }
+
+    return m;
+}
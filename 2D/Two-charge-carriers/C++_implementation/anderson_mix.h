@@ -0,0 +1,61 @@
+#ifndef ANDERSON_MIX_H
+#define ANDERSON_MIX_H
+
+#include <vector>
+#include "parameters.h"
+
+//!Anderson (Pulay/DIIS) accelerated mixing of old and new solutions for the Gummel iterations.
+//! One Gummel iteration is treated as a fixed point map x --> G(x) for the carrier densities x = (n, p).
+//! Instead of x_new = w*G(x) + (1-w)*x, the new x is extrapolated from the last few iterations,
+//! such that the residual G(x) - x is minimized in the least squares sense.
+//! All fields (i.e. n and p) are mixed together, since they are coupled through the recombination and the potential.
+class Anderson_mix
+{
+public:
+    //!\param num_fields is the # of vectors mixed together.
+    //!\param first_index and \param last_index give the range of entries which are mixed in each vector (the other entries are BC's).
+    //!\param depth is the number of previous iterations kept in the history.
+    Anderson_mix(int num_fields, int first_index, int last_index, int depth);
+
+    //!Sets the output of one Gummel iteration (\param new_values) and the input to that iteration (\param old_values)
+    //! for field # \param field. Must be called for each field before mix().
+    void set_field(int field, const std::vector<double> &new_values, const std::vector<double> &old_values);
+
+    //!Finds the mixed solution. The mixing factor w is taken from the \param params object.
+    void mix(const Parameters &params);
+
+    //!Copies the mixed solution for field # \param field into \param values (only the entries from first_index to last_index).
+    void get_result(int field, std::vector<double> &values) const;
+
+    //!Clears the history. Must be called when starting a new voltage or when w was changed.
+    void reset() {num_stored = 0; have_last = false;}
+
+private:
+    int first;
+    int length;  //# of mixed entries per field
+    int size;    //total # of mixed entries
+    int depth;
+
+    int num_stored;   //# of history entries currently stored
+    int newest;       //index of newest entry in the ring buffers
+    bool have_last;
+
+    //all fields are stored one after the other, indexed from 0
+    std::vector<double> x, f;  //input to the iteration and residual f = G(x) - x
+    std::vector<double> weight;
+    std::vector<double> result;
+    std::vector<std::vector<double> > dX;  //ring buffer of x_k - x_k-1
+    std::vector<std::vector<double> > dF;  //ring buffer of f_k - f_k-1
+    std::vector<double> last_x, last_f;
+
+    //QR factorization of the weighted dF's, for the least squares problem
+    std::vector<std::vector<double> > Q;
+    std::vector<double> R, gamma;
+    std::vector<int> column;  //history entry which corresponds to each (not dropped) column of Q
+
+    //!Finds gamma which minimizes |W*(f - dF*gamma)| using a modified Gram-Schmidt QR factorization.
+    //! Columns which are (nearly) linearly dependent on the newer ones are dropped. Returns the # of columns kept.
+    int solve_least_squares();
+};
+
+#endif // ANDERSON_MIX_H
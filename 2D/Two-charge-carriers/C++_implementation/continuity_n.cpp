@@ -1,4 +1,5 @@
 #include "continuity_n.h"
+#include "phase_timer.h"
 
 Continuity_n::Continuity_n(const Parameters &params)
 {
@@ -71,8 +72,11 @@ void Continuity_n::set_n_rightBC(const std::vector<double> &n)
 void Continuity_n::setup_eqn(const Eigen::MatrixXd &V_matrix, const Eigen::MatrixXd &Un_matrix, const std::vector<double> &n)
 {
     trp_cnt = 0;  //reset triplet count
-    Bernoulli_n_X(V_matrix);
-    Bernoulli_n_Z(V_matrix);
+    {
+        TIME_PHASE(Phase::bernoulli);
+        Bernoulli_n_X(V_matrix);
+        Bernoulli_n_Z(V_matrix);
+    }
     set_far_lower_diag();
     set_lower_diag();
     set_main_diag();
@@ -247,20 +251,15 @@ void Continuity_n::set_rhs(const Eigen::MatrixXd &Un_matrix)
 
 void Continuity_n::Bernoulli_n_X(const Eigen::MatrixXd &V_matrix)
 {
-    Eigen::MatrixXd dV = Eigen::MatrixXd::Zero(num_cell+1,num_cell+1);
-
-    for (int i = 1; i < num_cell+1; i++)             //Note: the indices are shifted by 1 from Matlab version (here bndry is at index 0)
-        for (int j = 1; j < num_cell+1; j++)
-            dV(i,j) =  V_matrix(i,j)-V_matrix(i-1,j);
-
     for (int i = 1; i < num_cell+1; i++) {           //note: the indexing done a bit different than Matlab (see 1D C++ version)
         for (int j = 1; j < num_cell+1; j++) {
-             if (abs(dV(i,j)) < 1e-13) {        //to prevent blowup due  to 0 denominator
+             double dV = V_matrix(i,j)-V_matrix(i-1,j);  //Note: the indices are shifted by 1 from Matlab version (here bndry is at index 0)
+             if (abs(dV) < 1e-13) {        //to prevent blowup due  to 0 denominator
                  Bn_posX(i,j) = 1;//1 - dV(i,j)/2. + (dV(i,j)*dV(i,j))/12. - pow(dV(i,j), 4)/720.;
                  Bn_negX(i,j) =  1;//Bn_posX(i,j)*exp(dV(i,j));
              } else {
-                Bn_posX(i,j) = dV(i,j)/(exp(dV(i,j)) - 1.0);
-                Bn_negX(i,j) = Bn_posX(i,j)*exp(dV(i,j));
+                Bn_posX(i,j) = dV/(exp(dV) - 1.0);
+                Bn_negX(i,j) = Bn_posX(i,j)*exp(dV);
              }
         }
     }
@@ -268,20 +267,15 @@ void Continuity_n::Bernoulli_n_X(const Eigen::MatrixXd &V_matrix)
 
 void Continuity_n::Bernoulli_n_Z(const Eigen::MatrixXd &V_matrix)
 {
-    Eigen::MatrixXd dV = Eigen::MatrixXd::Zero(num_cell+1,num_cell+1);
-
-    for (int i = 1; i < num_cell+1; i++)
-       for (int j = 1; j < num_cell+1; j++)
-           dV(i,j) =  V_matrix(i,j)-V_matrix(i,j-1);
-
     for (int i = 1; i < num_cell+1; i++) {
         for (int j = 1; j < num_cell+1; j++) {
-            if (abs(dV(i,j)) < 1e-13) {        //to prevent blowup due  to 0 denominator
+            double dV = V_matrix(i,j)-V_matrix(i,j-1);
+            if (abs(dV) < 1e-13) {        //to prevent blowup due  to 0 denominator
                 Bn_posZ(i,j) = 1;//1 - dV(i,j)/2. + (dV(i,j)*dV(i,j))/12. - pow(dV(i,j), 4)/720.;
                 Bn_negZ(i,j) =  1;//Bn_posZ(i,j)*exp(dV(i,j));
             } else {
-               Bn_posZ(i,j) = dV(i,j)/(exp(dV(i,j)) - 1.0);
-               Bn_negZ(i,j) = Bn_posZ(i,j)*exp(dV(i,j));
+               Bn_posZ(i,j) = dV/(exp(dV) - 1.0);
+               Bn_negZ(i,j) = Bn_posZ(i,j)*exp(dV);
             }
         }
     }
@@ -37,14 +37,14 @@ public:
     void set_n_rightBC(const std::vector<double> &n);
 
     //getters (const keyword ensures that fnc doesn't change anything)
-    Eigen::VectorXd get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
-    Eigen::SparseMatrix<double> get_sp_matrix() {return sp_matrix;}
-    Eigen::MatrixXd get_n_matrix() const {return n_matrix;}
-    std::vector<double> get_n_bottomBC() const {return n_bottomBC;}  //bottom and top are needed to set initial conditions
-    std::vector<double> get_n_topBC() const {return n_topBC;}
-
-    Eigen::MatrixXd get_Jn_X() const {return Jn_X;}
-    Eigen::MatrixXd get_Jn_Z() const {return Jn_Z;}
+    const Eigen::VectorXd &get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
+    const Eigen::SparseMatrix<double> &get_sp_matrix() const {return sp_matrix;}
+    const Eigen::MatrixXd &get_n_matrix() const {return n_matrix;}
+    const std::vector<double> &get_n_bottomBC() const {return n_bottomBC;}  //bottom and top are needed to set initial conditions
+    const std::vector<double> &get_n_topBC() const {return n_topBC;}
+
+    const Eigen::MatrixXd &get_Jn_X() const {return Jn_X;}
+    const Eigen::MatrixXd &get_Jn_Z() const {return Jn_Z;}
 
     //The below getters can be useful for testing and debugging
     //std::vector<double> get_main_diag() const {return main_diag;}
@@ -1,4 +1,5 @@
 #include "continuity_p.h"
+#include "phase_timer.h"
 
 Continuity_p::Continuity_p(const Parameters &params)
 {
@@ -69,8 +70,11 @@ void Continuity_p::set_p_rightBC(const std::vector<double> &p)
 void Continuity_p::setup_eqn(const Eigen::MatrixXd &V_matrix, const Eigen::MatrixXd &Up_matrix, const std::vector<double> &p)
 {
     trp_cnt = 0;  //reset triplet count
-    Bernoulli_p_X(V_matrix);
-    Bernoulli_p_Z(V_matrix);
+    {
+        TIME_PHASE(Phase::bernoulli);
+        Bernoulli_p_X(V_matrix);
+        Bernoulli_p_Z(V_matrix);
+    }
     set_far_lower_diag();
     set_lower_diag();
     set_main_diag();
@@ -196,20 +200,15 @@ void Continuity_p::set_far_upper_diag()
 
 void Continuity_p::Bernoulli_p_X(const Eigen::MatrixXd &V_matrix)
 {
-    Eigen::MatrixXd dV = Eigen::MatrixXd::Zero(num_cell+1,num_cell+1);
-
-    for (int i = 1; i < num_cell+1; i++)
-       for (int j = 1; j < num_cell+1; j++)
-           dV(i,j) =  V_matrix(i,j)-V_matrix(i-1,j);
-
     for (int i = 1; i < num_cell+1; i++) {
         for (int j = 1; j < num_cell+1; j++) {
-            if (abs(dV(i,j)) < 1e-13) {        //to prevent blowup due  to 0 denominator
+            double dV = V_matrix(i,j)-V_matrix(i-1,j);
+            if (abs(dV) < 1e-13) {        //to prevent blowup due  to 0 denominator
                 Bp_posX(i,j) = 1;//1 - dV(i,j)/2. + (dV(i,j)*dV(i,j))/12. - pow(dV(i,j), 4)/720.;
                 Bp_negX(i,j) =  1;//Bp_posX(i,j)*exp(dV(i,j));
             } else {
-               Bp_posX(i,j) = dV(i,j)/(exp(dV(i,j)) - 1.0);
-               Bp_negX(i,j) = Bp_posX(i,j)*exp(dV(i,j));
+               Bp_posX(i,j) = dV/(exp(dV) - 1.0);
+               Bp_negX(i,j) = Bp_posX(i,j)*exp(dV);
             }
         }
     }
@@ -217,20 +216,15 @@ void Continuity_p::Bernoulli_p_X(const Eigen::MatrixXd &V_matrix)
 
 void Continuity_p::Bernoulli_p_Z(const Eigen::MatrixXd &V_matrix)
 {
-    Eigen::MatrixXd dV = Eigen::MatrixXd::Zero(num_cell+1,num_cell+1);
-
-    for (int i = 1; i < num_cell+1; i++)
-       for (int j = 1; j < num_cell+1; j++)
-           dV(i,j) =  V_matrix(i,j)-V_matrix(i,j-1);
-
     for (int i = 1; i < num_cell+1; i++) {
         for (int j = 1; j < num_cell+1; j++) {
-            if (abs(dV(i,j)) < 1e-13) {        //to prevent blowup due  to 0 denominator
+            double dV = V_matrix(i,j)-V_matrix(i,j-1);
+            if (abs(dV) < 1e-13) {        //to prevent blowup due  to 0 denominator
                 Bp_posZ(i,j) = 1;//1 - dV(i,j)/2. + (dV(i,j)*dV(i,j))/12. - pow(dV(i,j), 4)/720.;
                 Bp_negZ(i,j) =  1;//Bp_posZ(i,j)*exp(dV(i,j));
             } else {
-               Bp_posZ(i,j) = dV(i,j)/(exp(dV(i,j)) - 1.0);
-               Bp_negZ(i,j) = Bp_posZ(i,j)*exp(dV(i,j));
+               Bp_posZ(i,j) = dV/(exp(dV) - 1.0);
+               Bp_negZ(i,j) = Bp_posZ(i,j)*exp(dV);
             }
         }
     }
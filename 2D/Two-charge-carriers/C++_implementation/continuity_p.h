@@ -37,14 +37,14 @@ public:
     void set_p_rightBC(const std::vector<double> &p);
 
     //getters
-    Eigen::VectorXd get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
-    Eigen::SparseMatrix<double> get_sp_matrix() const {return sp_matrix;}
-    Eigen::MatrixXd get_p_matrix() const {return p_matrix;}
-    std::vector<double> get_p_topBC() const {return p_topBC;} //bottom and top are needed to set initial conditions
-    std::vector<double> get_p_bottomBC() const {return p_bottomBC;}
-
-    Eigen::MatrixXd get_Jp_X() const {return Jp_X;}
-    Eigen::MatrixXd get_Jp_Z() const {return Jp_Z;}
+    const Eigen::VectorXd &get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
+    const Eigen::SparseMatrix<double> &get_sp_matrix() const {return sp_matrix;}
+    const Eigen::MatrixXd &get_p_matrix() const {return p_matrix;}
+    const std::vector<double> &get_p_topBC() const {return p_topBC;} //bottom and top are needed to set initial conditions
+    const std::vector<double> &get_p_bottomBC() const {return p_bottomBC;}
+
+    const Eigen::MatrixXd &get_Jp_X() const {return Jp_X;}
+    const Eigen::MatrixXd &get_Jp_Z() const {return Jp_Z;}
 
     //The below getters can be useful for testing and debugging
     //std::vector<double> get_main_diag() const {return main_diag;}
@@ -0,0 +1,70 @@
+#ifndef OUTPUT_POLICY_H
+#define OUTPUT_POLICY_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//!The part of a field array that is written: the kept indices along each axis
+struct Output_region
+{
+    std::vector<std::vector<uint32_t> > indices;   //indices[d] are the kept indices of the array along axis d, ascending
+    std::vector<double> origin;                    //coordinate of the 1st kept point along each axis
+    double spacing;                                //distance between kept points
+
+    std::vector<uint32_t> dims() const;            //# of kept points along each axis
+    uint64_t size() const;                         //total # of kept points
+
+    //!Copies the kept points of \param values (an array of \param full_dims points, 1st index changing fastest) to
+    //! \param result, in the same order. \param result is resized, so it can be reused without allocating.
+    void extract(const double *values, const std::vector<uint32_t> &full_dims, std::vector<double> &result) const;
+};
+
+
+//!Selects what of the fields (V, n, p, etc.) is written, so the details output can be left on without writing everything:
+//! at which voltages, which fields, which part of the mesh, and with which decimation.
+class Output_policy
+{
+public:
+    //!\param voltages: "all", or "stride:k" (every k'th voltage), "list:Va1,Va2,..." (the voltages nearest to these),
+    //!   "Voc" (the two voltages around the open circuit voltage) and "MPP" (the voltage nearest to the maximum power point),
+    //!   combined with + (e.g. "stride:10+Voc+MPP")
+    //! \param fields: "all" or a comma separated list of names, which must be in \param field_names
+    //! \param region: "all" or grid index ranges, comma separated, of the axes \param axis_names (e.g. "x=10:90,z=0:50"). A single
+    //!   index gives a slice plane (e.g. "y=20"). Axes not given are kept whole.
+    //! \param decimation: only every decimation'th point along each axis is written
+    //! \param increment is the voltage step of the sweep, \param dx the mesh spacing.
+    //! Throws std::runtime_error if a specification is invalid.
+    Output_policy(const std::string &voltages, const std::string &fields, const std::string &region, int decimation,
+                  const std::vector<std::string> &field_names, const std::vector<std::string> &axis_names, double increment, double dx);
+
+    //!Call once for each voltage of the sweep (not for the equilibrium run), in order, with the current \param J at \param Va.
+    //! Sets \param write_current if this voltage is to be written and \param write_previous if the previous one is:
+    //! Voc and the MPP are only found one voltage later, so then the previous voltage's fields must still be available.
+    void next_voltage(double Va, double J, bool &write_previous, bool &write_current);
+
+    //!True if the fields of each voltage must be kept until the next voltage (if Voc or MPP are selected)
+    bool keeps_previous() const {return Voc || MPP;}
+
+    //!True if field \param name is written
+    bool has_field(const std::string &name) const;
+
+    //!Returns the written region of an array of \param dims points whose index 0 is at grid index \param first_index
+    //! (e.g. 1 for arrays of the interior points only) along each axis
+    Output_region select(const std::vector<uint32_t> &dims, int first_index) const;
+
+private:
+    bool all_voltages, Voc, MPP;
+    int stride;                        //0 if not used
+    std::vector<double> list;
+    double increment, dx;
+    std::vector<std::string> fields;   //empty = all
+    std::vector<int> region_begin, region_end;   //grid indices per axis (inclusive), -1 = whole axis
+    int decimation;
+
+    int Va_cnt;
+    double previous_J, previous_power, before_previous_power;
+    bool previous_written, MPP_found;
+};
+
+#endif // OUTPUT_POLICY_H
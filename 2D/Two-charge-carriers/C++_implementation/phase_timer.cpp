@@ -0,0 +1,193 @@
+#include "phase_timer.h"
+
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+namespace {
+    const int num_phases = static_cast<int>(Phase::num_phases);
+    const char *phase_names[num_phases] = {"poisson_assembly", "poisson_solve", "bernoulli", "continuity_assembly",
+                                           "factorization", "solve", "mixing", "output"};
+
+    thread_local Phase_timers *active_timers = nullptr;
+
+    //writes "name": {"time": t, "calls": n, hardware counts}, or "name": t if calls < 0. \param hw_counts is null if not counted.
+    // Besides the counts, the instructions per cycle and the bytes loaded from memory (64 byte cache lines) per instruction are written.
+    void write_entry(std::ofstream &file, const std::string &name, double time, long long calls, const std::vector<uint64_t> *hw_counts = nullptr)
+    {
+        file << "\"" << name << "\": ";
+        if (calls < 0) {
+            file << time;
+            return;
+        }
+        file << "{\"time\": " << time << ", \"calls\": " << calls;
+        if (hw_counts) {
+            const std::vector<uint64_t> &counts = *hw_counts;
+            for (int k = 0; k < Hw_counters::num_counters; k++)
+                file << ", \"" << Hw_counters::name(static_cast<Hw_counters::Counter>(k)) << "\": " << counts[k];
+            const double instructions = static_cast<double>(counts[Hw_counters::instructions]);
+            file << ", \"ipc\": " << (counts[Hw_counters::cycles] ? instructions/counts[Hw_counters::cycles] : 0.0)
+                 << ", \"memory_bytes_per_instruction\": " << (instructions > 0 ? 64.0*counts[Hw_counters::llc_misses]/instructions : 0.0);
+        }
+        file << "}";
+    }
+}
+
+
+Phase_timers::Phase_timers()
+    : run_start(Clock::now()), phase_start(run_start), voltage_start(run_start), current(Phase::num_phases), in_voltage(false),
+      run_times(num_phases, 0.0), calls(num_phases, 0), hw_status("off"),
+      hw_counts(num_phases, std::vector<uint64_t>(Hw_counters::num_counters, 0))
+{
+}
+
+
+Phase_timers::~Phase_timers()
+{
+    deactivate();
+}
+
+
+void Phase_timers::activate()
+{
+    active_timers = this;
+}
+
+
+void Phase_timers::deactivate()
+{
+    if (active_timers == this)
+        active_timers = nullptr;
+}
+
+
+bool Phase_timers::use_hardware_counters()
+{
+    if (!hw_counters.open() || !hw_counters.read(last_hw_counts)) {
+        hw_status = "unavailable: " + hw_counters.error();
+        std::cerr << "Hardware counters " << hw_status << std::endl;
+        hw_counters.close();
+        return false;
+    }
+    hw_status = "on";
+    return true;
+}
+
+
+Phase_timers *Phase_timers::active()
+{
+    return active_timers;
+}
+
+
+void Phase_timers::start_voltage(double Va)
+{
+    const Clock::time_point now = Clock::now();
+    charge_current(now);
+    voltages.push_back({Va, 0, 0.0, std::vector<double>(num_phases, 0.0)});
+    voltage_start = now;
+    in_voltage = true;
+}
+
+
+void Phase_timers::end_voltage(int iterations)
+{
+    const Clock::time_point now = Clock::now();
+    charge_current(now);
+    if (in_voltage) {
+        voltages.back().iterations = iterations;
+        voltages.back().time = std::chrono::duration<double>(now - voltage_start).count();
+    }
+    in_voltage = false;
+}
+
+
+Phase Phase_timers::enter(Phase phase, bool count)
+{
+    charge_current(Clock::now());
+    const Phase previous = current;
+    current = phase;
+    if (count && phase != Phase::num_phases)
+        calls[static_cast<int>(phase)]++;
+    return previous;
+}
+
+
+void Phase_timers::charge_current(Clock::time_point now)
+{
+    if (current != Phase::num_phases) {
+        const double time = std::chrono::duration<double>(now - phase_start).count();
+        run_times[static_cast<int>(current)] += time;
+        if (in_voltage)
+            voltages.back().phases[static_cast<int>(current)] += time;
+    }
+    phase_start = now;
+
+    uint64_t counts[Hw_counters::num_counters];
+    if (hw_counters.is_open() && hw_counters.read(counts)) {
+        for (int k = 0; k < Hw_counters::num_counters; k++) {
+            if (current != Phase::num_phases)
+                hw_counts[static_cast<int>(current)][k] += counts[k] - last_hw_counts[k];
+            last_hw_counts[k] = counts[k];
+        }
+    }
+}
+
+
+bool Phase_timers::write_report(const std::string &file_name, const std::string &engine, int num_cell) const
+{
+    std::ofstream file(file_name);
+    if (!file) {
+        std::cerr << "Unable to open timing report file " << file_name << std::endl;
+        return false;
+    }
+    file << std::setprecision(6);
+
+    const double total_time = std::chrono::duration<double>(Clock::now() - run_start).count();
+    double phases_time = 0;
+    for (int k = 0; k < num_phases; k++)
+        phases_time += run_times[k];
+
+    file << "{\n";
+    file << "  \"engine\": \"" << engine << "\",\n";
+    file << "  \"num_cell\": " << num_cell << ",\n";
+#ifdef DD_NO_TIMERS
+    file << "  \"timers_compiled\": false,\n";
+#else
+    file << "  \"timers_compiled\": true,\n";
+#endif
+    file << "  \"total_time\": " << total_time << ",\n";
+    file << "  \"hardware_counters\": \"" << hw_status << "\",\n";
+
+    file << "  \"run\": {";
+    for (int k = 0; k < num_phases; k++) {
+        file << (k ? ", " : "");
+        write_entry(file, phase_names[k], run_times[k], calls[k], hw_counters.is_open() ? &hw_counts[k] : nullptr);
+    }
+    file << ", ";
+    write_entry(file, "other", total_time - phases_time, -1);
+    file << "},\n";
+
+    file << "  \"voltages\": [";
+    for (size_t v = 0; v < voltages.size(); v++) {
+        const Voltage_record &record = voltages[v];
+        double voltage_phases_time = 0;
+        file << (v ? ",\n" : "\n") << "    {\"Va\": " << record.Va << ", \"iterations\": " << record.iterations
+             << ", \"time\": " << record.time << ", \"phases\": {";
+        for (int k = 0; k < num_phases; k++) {
+            file << (k ? ", " : "");
+            write_entry(file, phase_names[k], record.phases[k], -1);
+            voltage_phases_time += record.phases[k];
+        }
+        file << ", ";
+        write_entry(file, "other", record.time - voltage_phases_time, -1);
+        file << "}}";
+    }
+    file << "\n  ]\n}\n";
+
+    if (!file) {
+        std::cerr << "Unable to write timing report file " << file_name << std::endl;
+        return false;
+    }
+    return true;
+}
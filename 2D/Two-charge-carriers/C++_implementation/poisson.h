@@ -34,11 +34,11 @@ public:
     void set_V_rightBC(const std::vector<double> &V);
 
     //getters
-    Eigen::VectorXd get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
-    Eigen::SparseMatrix<double> get_sp_matrix() const {return sp_matrix;}
-    std::vector<double> get_V_topBC() const {return V_topBC;}    //top and bottom  bc getters are needed to determine initial V
-    std::vector<double> get_V_bottomBC() const {return V_bottomBC;}
-    Eigen::MatrixXd get_V_matrix() const {return V_matrix;}
+    const Eigen::VectorXd &get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
+    const Eigen::SparseMatrix<double> &get_sp_matrix() const {return sp_matrix;}
+    const std::vector<double> &get_V_topBC() const {return V_topBC;}    //top and bottom  bc getters are needed to determine initial V
+    const std::vector<double> &get_V_bottomBC() const {return V_bottomBC;}
+    const Eigen::MatrixXd &get_V_matrix() const {return V_matrix;}
 
     //The below getters can be useful for testing and debugging
     //std::vector<double> get_main_diag() const {return main_diag;}
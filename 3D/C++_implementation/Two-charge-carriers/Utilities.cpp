@@ -1,19 +1,16 @@
 #include "Utilities.h"
 #include "parameters.h"
+#include <algorithm>
 
 Utilities::Utilities()
 {
 }
 
-std::vector<double> Utilities::linear_mix(const Parameters &params, const std::vector<double> &new_values,const std::vector<double> &old_values)
+void Utilities::linear_mix(const Parameters &params, const std::vector<double> &new_values, const std::vector<double> &old_values, std::vector<double> &result)
 {
-    static std::vector<double> result(params.num_elements+1);  //static so only allocate at 1st fnc call
-
     for (int i = 1; i <= params.num_elements; i++) {  //note: all the changing values in vectors start from 1 (0th index is a BC)
         result[i] = new_values[i]*params.w + old_values[i]*(1.0 - params.w);
     }
-
-    return result;
 }
 
 
@@ -53,3 +50,41 @@ void Utilities::write_JV(const Parameters &params, std::ofstream &JV, double ite
         JV << Va << " " << J_total_Z(i,i,i) << " " << iter << "\n";
     }
 }
+
+
+void Utilities::to_grid(const Parameters &params, const std::vector<double> &values, double bottom_BC, double top_BC, std::vector<double> &grid)
+{
+    const int num_cell = params.num_cell;
+    const int N = num_cell - 1;
+    grid.resize(static_cast<size_t>(num_cell+1)*(num_cell+1)*(num_cell+1));
+
+    size_t g = 0;
+    for (int k = 0; k <= num_cell; k++) {
+        for (int j = 0; j <= num_cell; j++) {
+            const int j_in = std::min(std::max(j, 1), N);  //nearest interior point
+            for (int i = 0; i <= num_cell; i++, g++) {
+                const int i_in = std::min(std::max(i, 1), N);
+                if (k == 0)
+                    grid[g] = bottom_BC;
+                else if (k == num_cell)
+                    grid[g] = top_BC;
+                else
+                    grid[g] = values[i_in + (j_in-1)*N + (k-1)*N*N];
+            }
+        }
+    }
+}
+
+void Utilities::write_convergence_header(std::ofstream &file)
+{
+    if (file.is_open())
+        file << "#Va iterations error w tolerance w_reductions time\n";
+}
+
+void Utilities::write_convergence(std::ofstream &file, const Convergence_record &record)
+{
+    if (file.is_open()) {
+        file << record.Va << " " << record.iterations << " " << record.error << " " << record.w << " " << record.tolerance
+             << " " << record.w_reductions << " " << record.time << "\n";
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef ASYNC_OUTPUT_H
+#define ASYNC_OUTPUT_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <exception>
+#include <iostream>
+
+//!Writes the output of each voltage (JV line, details) on a background thread, so the solver can go on with the next voltage
+//! while the previous one is written. The solver fills a Record (its own struct with the values to write) and hands it over.
+//! The records are kept in a ring of num_records (2 = double buffering) that is reused, so after the first voltages no memory
+//! is allocated (if Record's assignment reuses its buffers, as std::vector and Eigen matrices of the same size do).
+//! The ring is a lock-free single producer (the solver thread) / single consumer (the writer thread) queue. The solver only
+//! waits if the writer is num_records voltages behind.
+template<typename Record> class Async_output
+{
+public:
+    typedef std::function<void(const Record&)> Write_function;
+
+    //!Starts the writer thread, which calls \param write for each submitted record, in the order they were submitted
+    Async_output(const Write_function &write, int num_records = 2)
+        : write(write), records(num_records > 0 ? num_records : 2), head(0), tail(0), stop(false)
+    {
+        writer = std::thread(&Async_output::writer_loop, this);
+    }
+
+    //!Writes everything submitted, then stops the writer thread
+    ~Async_output() {finish();}
+
+    //!Returns the record to fill for the next voltage. Waits until the writer is done with it.
+    Record &acquire()
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        for (int spins = 0; h - tail.load(std::memory_order_acquire) == records.size(); spins++)
+            back_off(spins, 100);
+        return records[h % records.size()];
+    }
+
+    //!Hands the record returned by acquire() to the writer thread
+    void submit() {head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);}
+
+    //!Waits until all submitted records are written and stops the writer thread. Nothing can be submitted afterwards.
+    void finish()
+    {
+        if (!writer.joinable())
+            return;
+        stop.store(true, std::memory_order_release);
+        writer.join();
+    }
+
+private:
+    Write_function write;
+    std::vector<Record> records;
+    std::atomic<size_t> head;   //# of records submitted (only changed by the solver thread)
+    std::atomic<size_t> tail;   //# of records written (only changed by the writer thread)
+    std::atomic<bool> stop;
+    std::thread writer;
+
+    //busy wait for a short time (a record is usually ready soon), then sleep so an idle writer doesn't take time from the solver
+    static void back_off(int spins, int sleep_us)
+    {
+        if (spins < 16)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+    }
+
+    void writer_loop()
+    {
+        for (int spins = 0; ; spins++) {
+            const size_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) {
+                if (stop.load(std::memory_order_acquire) && t == head.load(std::memory_order_acquire))
+                    return;   //stopped, and everything is written
+                back_off(spins, 1000);   //nothing waits for the output, so the writer can sleep longer
+                continue;
+            }
+
+            try {
+                write(records[t % records.size()]);
+            }
+            catch (std::exception &e) {
+                std::cerr << "Writing output failed: " << e.what() << std::endl;  //the run can continue without it
+            }
+            tail.store(t + 1, std::memory_order_release);
+            spins = 0;
+        }
+    }
+};
+
+#endif // ASYNC_OUTPUT_H
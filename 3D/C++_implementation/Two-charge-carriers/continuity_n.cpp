@@ -1,4 +1,5 @@
 #include "continuity_n.h"
+#include "phase_timer.h"
 
 Continuity_n::Continuity_n(const Parameters &params)
 {
@@ -131,9 +132,12 @@ void Continuity_n::set_n_rightBC_Y(const std::vector<double> &n)
 void Continuity_n::setup_eqn(const Eigen::Tensor<double, 3> &V_matrix, const std::vector<double> &Un, const std::vector<double> &n)
 {
     trp_cnt = 0;  //reset triplet count
-    Bernoulli_n_X(V_matrix);
-    Bernoulli_n_Y(V_matrix);
-    Bernoulli_n_Z(V_matrix);
+    {
+        TIME_PHASE(Phase::bernoulli);
+        Bernoulli_n_X(V_matrix);
+        Bernoulli_n_Y(V_matrix);
+        Bernoulli_n_Z(V_matrix);
+    }
 
     set_far_lower_diag();
     set_lower_diag();
@@ -414,23 +418,16 @@ void Continuity_n::set_rhs(const std::vector<double> &Un)
 
 void Continuity_n::Bernoulli_n_X(const Eigen::Tensor<double, 3> &V_matrix)
 {
-    Eigen::Tensor<double, 3> dV(num_cell+1, num_cell+1, num_cell+1);
-    dV.setZero();
-
-    for (int i = 1; i < num_cell+1; i++)
-       for (int j = 1; j < num_cell+1; j++)
-           for (int k = 1; k < num_cell+1; k++)
-                dV(i,j,k) =  V_matrix(i,j,k)-V_matrix(i-1,j,k);
-
     for (int i = 1; i < num_cell+1; i++) {
         for (int j = 1; j < num_cell+1; j++) {
             for (int k = 1; k < num_cell+1; k++) {
-                if (abs(dV(i,j,k)) < 1e-13) {        //to prevent blowup due  to 0 denominator
+                double dV = V_matrix(i,j,k)-V_matrix(i-1,j,k);
+                if (abs(dV) < 1e-13) {        //to prevent blowup due  to 0 denominator
                     Bn_posX(i,j,k) = 1;//1 - dV(i,j)/2. + (dV(i,j)*dV(i,j))/12. - pow(dV(i,j), 4)/720.;
                     Bn_negX(i,j,k) =  1;//Bn_posX(i,j)*exp(dV(i,j));
                 } else {
-                    Bn_posX(i,j,k) = dV(i,j,k)/(exp(dV(i,j,k)) - 1.0);
-                    Bn_negX(i,j,k) = Bn_posX(i,j,k)*exp(dV(i,j,k));
+                    Bn_posX(i,j,k) = dV/(exp(dV) - 1.0);
+                    Bn_negX(i,j,k) = Bn_posX(i,j,k)*exp(dV);
                 }
             }
         }
@@ -439,23 +436,16 @@ void Continuity_n::Bernoulli_n_X(const Eigen::Tensor<double, 3> &V_matrix)
 
 void Continuity_n::Bernoulli_n_Y(const Eigen::Tensor<double, 3> &V_matrix)
 {
-    Eigen::Tensor<double, 3> dV(num_cell+1, num_cell+1, num_cell+1);
-    dV.setZero();
-
-    for (int i = 1; i < num_cell+1; i++)
-       for (int j = 1; j < num_cell+1; j++)
-           for (int k = 1; k < num_cell+1; k++)
-                dV(i,j,k) =  V_matrix(i,j,k)-V_matrix(i,j-1,k);
-
     for (int i = 1; i < num_cell+1; i++) {
         for (int j = 1; j < num_cell+1; j++) {
             for (int k = 1; k < num_cell+1; k++) {
-                if (abs(dV(i,j,k)) < 1e-13) {        //to prevent blowup due  to 0 denominator
+                double dV = V_matrix(i,j,k)-V_matrix(i,j-1,k);
+                if (abs(dV) < 1e-13) {        //to prevent blowup due  to 0 denominator
                     Bn_posY(i,j,k) = 1;//1 - dV(i,j)/2. + (dV(i,j)*dV(i,j))/12. - pow(dV(i,j), 4)/720.;
                     Bn_negY(i,j,k) =  1;//Bn_posZ(i,j)*exp(dV(i,j));
                 } else {
-                   Bn_posY(i,j,k) = dV(i,j,k)/(exp(dV(i,j,k)) - 1.0);
-                   Bn_negY(i,j,k) = Bn_posY(i,j,k)*exp(dV(i,j,k));
+                   Bn_posY(i,j,k) = dV/(exp(dV) - 1.0);
+                   Bn_negY(i,j,k) = Bn_posY(i,j,k)*exp(dV);
                 }
             }
         }
@@ -465,23 +455,16 @@ void Continuity_n::Bernoulli_n_Y(const Eigen::Tensor<double, 3> &V_matrix)
 
 void Continuity_n::Bernoulli_n_Z(const Eigen::Tensor<double, 3> &V_matrix)
 {
-    Eigen::Tensor<double, 3> dV(num_cell+1, num_cell+1, num_cell+1);
-    dV.setZero();
-
-    for (int i = 1; i < num_cell+1; i++)
-       for (int j = 1; j < num_cell+1; j++)
-           for (int k = 1; k < num_cell+1; k++)
-                dV(i,j,k) =  V_matrix(i,j,k)-V_matrix(i,j,k-1);
-
     for (int i = 1; i < num_cell+1; i++) {
         for (int j = 1; j < num_cell+1; j++) {
             for (int k = 1; k < num_cell+1; k++) {
-                if (abs(dV(i,j,k)) < 1e-13) {        //to prevent blowup due  to 0 denominator
+                double dV = V_matrix(i,j,k)-V_matrix(i,j,k-1);
+                if (abs(dV) < 1e-13) {        //to prevent blowup due  to 0 denominator
                     Bn_posZ(i,j,k) = 1;//1 - dV(i,j)/2. + (dV(i,j)*dV(i,j))/12. - pow(dV(i,j), 4)/720.;
                     Bn_negZ(i,j,k) =  1;//Bn_posZ(i,j)*exp(dV(i,j));
                 } else {
-                   Bn_posZ(i,j,k) = dV(i,j,k)/(exp(dV(i,j,k)) - 1.0);
-                   Bn_negZ(i,j,k) = Bn_posZ(i,j,k)*exp(dV(i,j,k));
+                   Bn_posZ(i,j,k) = dV/(exp(dV) - 1.0);
+                   Bn_negZ(i,j,k) = Bn_posZ(i,j,k)*exp(dV);
                 }
             }
         }
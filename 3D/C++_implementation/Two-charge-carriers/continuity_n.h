@@ -40,15 +40,15 @@ public:
     void set_n_rightBC_Y(const std::vector<double> &n);
 
     //getters (const keyword ensures that fnc doesn't change anything)
-    Eigen::VectorXd get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
-    Eigen::SparseMatrix<double> get_sp_matrix() {return sp_matrix;}
-    Eigen::Tensor<double, 3> get_n_matrix() const {return n_matrix;}
+    const Eigen::VectorXd &get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
+    const Eigen::SparseMatrix<double> &get_sp_matrix() const {return sp_matrix;}
+    const Eigen::Tensor<double, 3> &get_n_matrix() const {return n_matrix;}
     double get_n_bottomBC(int i, int j) const {return n_bottomBC(i,j);}  //bottom and top are needed to set initial conditions
     double get_n_topBC(int i, int j) const {return n_topBC(i,j);}
 
-    Eigen::Tensor<double, 3> get_Jn_X() const {return Jn_X;}
-    Eigen::Tensor<double, 3> get_Jn_Y() const {return Jn_Y;}
-    Eigen::Tensor<double, 3> get_Jn_Z() const {return Jn_Z;}
+    const Eigen::Tensor<double, 3> &get_Jn_X() const {return Jn_X;}
+    const Eigen::Tensor<double, 3> &get_Jn_Y() const {return Jn_Y;}
+    const Eigen::Tensor<double, 3> &get_Jn_Z() const {return Jn_Z;}
 
     //The below getters can be useful for testing and debugging
     //std::vector<double> get_main_diag() const {return main_diag;}
@@ -1,4 +1,5 @@
 #include "continuity_p.h"
+#include "phase_timer.h"
 
 Continuity_p::Continuity_p(const Parameters &params)
 {
@@ -129,9 +130,12 @@ void Continuity_p::set_p_rightBC_Y(const std::vector<double> &p)
 void Continuity_p::setup_eqn(const Eigen::Tensor<double, 3> &V_matrix, const std::vector<double> &Up, const std::vector<double> &p)
 {
     trp_cnt = 0;  //reset triplet count
-    Bernoulli_p_X(V_matrix);
-    Bernoulli_p_Y(V_matrix);
-    Bernoulli_p_Z(V_matrix);
+    {
+        TIME_PHASE(Phase::bernoulli);
+        Bernoulli_p_X(V_matrix);
+        Bernoulli_p_Y(V_matrix);
+        Bernoulli_p_Z(V_matrix);
+    }
 
     set_far_lower_diag();
     set_lower_diag();
@@ -287,23 +291,16 @@ void Continuity_p::set_far_upper_diag()
 
 void Continuity_p::Bernoulli_p_X(const Eigen::Tensor<double, 3> &V_matrix)
 {
-    Eigen::Tensor<double, 3> dV(num_cell+1, num_cell+1, num_cell+1);
-    dV.setZero();
-
-    for (int i = 1; i < num_cell+1; i++)
-       for (int j = 1; j < num_cell+1; j++)
-           for (int k = 1; k < num_cell+1; k++)
-                dV(i,j,k) =  V_matrix(i,j,k)-V_matrix(i-1,j,k);
-
     for (int i = 1; i < num_cell+1; i++) {
         for (int j = 1; j < num_cell+1; j++) {
             for (int k = 1; k < num_cell+1; k++) {
-                if (abs(dV(i,j,k)) < 1e-13) {        //to prevent blowup due  to 0 denominator
+                double dV = V_matrix(i,j,k)-V_matrix(i-1,j,k);
+                if (abs(dV) < 1e-13) {        //to prevent blowup due  to 0 denominator
                     Bp_posX(i,j,k) = 1;//1 - dV(i,j)/2. + (dV(i,j)*dV(i,j))/12. - pow(dV(i,j), 4)/720.;
                     Bp_negX(i,j,k) =  1;//Bp_posX(i,j)*exp(dV(i,j));
                 } else {
-                    Bp_posX(i,j,k) = dV(i,j,k)/(exp(dV(i,j,k)) - 1.0);
-                    Bp_negX(i,j,k) = Bp_posX(i,j,k)*exp(dV(i,j,k));
+                    Bp_posX(i,j,k) = dV/(exp(dV) - 1.0);
+                    Bp_negX(i,j,k) = Bp_posX(i,j,k)*exp(dV);
                 }
             }
         }
@@ -312,23 +309,16 @@ void Continuity_p::Bernoulli_p_X(const Eigen::Tensor<double, 3> &V_matrix)
 
 void Continuity_p::Bernoulli_p_Y(const Eigen::Tensor<double, 3> &V_matrix)
 {
-    Eigen::Tensor<double, 3> dV(num_cell+1, num_cell+1, num_cell+1);
-    dV.setZero();
-
-    for (int i = 1; i < num_cell+1; i++)
-       for (int j = 1; j < num_cell+1; j++)
-           for (int k = 1; k < num_cell+1; k++)
-                dV(i,j,k) =  V_matrix(i,j,k)-V_matrix(i,j-1,k);
-
     for (int i = 1; i < num_cell+1; i++) {
         for (int j = 1; j < num_cell+1; j++) {
             for (int k = 1; k < num_cell+1; k++) {
-                if (abs(dV(i,j,k)) < 1e-13) {        //to prevent blowup due  to 0 denominator
+                double dV = V_matrix(i,j,k)-V_matrix(i,j-1,k);
+                if (abs(dV) < 1e-13) {        //to prevent blowup due  to 0 denominator
                     Bp_posY(i,j,k) = 1;//1 - dV(i,j)/2. + (dV(i,j)*dV(i,j))/12. - pow(dV(i,j), 4)/720.;
                     Bp_negY(i,j,k) =  1;//Bp_posZ(i,j)*exp(dV(i,j));
                 } else {
-                   Bp_posY(i,j,k) = dV(i,j,k)/(exp(dV(i,j,k)) - 1.0);
-                   Bp_negY(i,j,k) = Bp_posY(i,j,k)*exp(dV(i,j,k));
+                   Bp_posY(i,j,k) = dV/(exp(dV) - 1.0);
+                   Bp_negY(i,j,k) = Bp_posY(i,j,k)*exp(dV);
                 }
             }
         }
@@ -338,23 +328,16 @@ void Continuity_p::Bernoulli_p_Y(const Eigen::Tensor<double, 3> &V_matrix)
 
 void Continuity_p::Bernoulli_p_Z(const Eigen::Tensor<double, 3> &V_matrix)
 {
-    Eigen::Tensor<double, 3> dV(num_cell+1, num_cell+1, num_cell+1);
-    dV.setZero();
-
-    for (int i = 1; i < num_cell+1; i++)
-       for (int j = 1; j < num_cell+1; j++)
-           for (int k = 1; k < num_cell+1; k++)
-                dV(i,j,k) =  V_matrix(i,j,k)-V_matrix(i,j,k-1);
-
     for (int i = 1; i < num_cell+1; i++) {
         for (int j = 1; j < num_cell+1; j++) {
             for (int k = 1; k < num_cell+1; k++) {
-                if (abs(dV(i,j,k)) < 1e-13) {        //to prevent blowup due  to 0 denominator
+                double dV = V_matrix(i,j,k)-V_matrix(i,j,k-1);
+                if (abs(dV) < 1e-13) {        //to prevent blowup due  to 0 denominator
                     Bp_posZ(i,j,k) = 1;//1 - dV(i,j)/2. + (dV(i,j)*dV(i,j))/12. - pow(dV(i,j), 4)/720.;
                     Bp_negZ(i,j,k) =  1;//Bp_posZ(i,j)*exp(dV(i,j));
                 } else {
-                   Bp_posZ(i,j,k) = dV(i,j,k)/(exp(dV(i,j,k)) - 1.0);
-                   Bp_negZ(i,j,k) = Bp_posZ(i,j,k)*exp(dV(i,j,k));
+                   Bp_posZ(i,j,k) = dV/(exp(dV) - 1.0);
+                   Bp_negZ(i,j,k) = Bp_posZ(i,j,k)*exp(dV);
                 }
             }
         }
@@ -40,15 +40,15 @@ public:
     void set_p_rightBC_Y(const std::vector<double> &p);
 
     //getters
-    Eigen::VectorXd get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
-    Eigen::SparseMatrix<double> get_sp_matrix() const {return sp_matrix;}
-    Eigen::Tensor<double, 3> get_p_matrix() const {return p_matrix;}
+    const Eigen::VectorXd &get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
+    const Eigen::SparseMatrix<double> &get_sp_matrix() const {return sp_matrix;}
+    const Eigen::Tensor<double, 3> &get_p_matrix() const {return p_matrix;}
     double get_p_bottomBC(int i, int j) const {return p_bottomBC(i,j);}  //bottom and top are needed to set initial conditions
     double get_p_topBC(int i, int j) const {return p_topBC(i,j);}
 
-    Eigen::Tensor<double, 3> get_Jp_X() const {return Jp_X;}
-    Eigen::Tensor<double, 3> get_Jp_Y() const {return Jp_Y;}
-    Eigen::Tensor<double, 3> get_Jp_Z() const {return Jp_Z;}
+    const Eigen::Tensor<double, 3> &get_Jp_X() const {return Jp_X;}
+    const Eigen::Tensor<double, 3> &get_Jp_Y() const {return Jp_Y;}
+    const Eigen::Tensor<double, 3> &get_Jp_Z() const {return Jp_Z;}
 
     //The below getters can be useful for testing and debugging
     //std::vector<double> get_main_diag() const {return main_diag;}
@@ -0,0 +1,131 @@
+#include "hw_counters.h"
+
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char *counter_names[Hw_counters::num_counters] = {"cycles", "instructions", "llc_misses", "branch_misses"};
+
+#ifdef __linux__
+    const uint64_t counter_configs[Hw_counters::num_counters] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                                 PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    int open_counter(uint64_t config, int group_fd)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = (group_fd < 0) ? 1 : 0;   //the group is started with the leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));  //this thread, any CPU
+    }
+#endif
+}
+
+
+Hw_counters::Hw_counters() : group_fd(-1), num_open(0)
+{
+    for (int k = 0; k < num_counters; k++) {
+        fds[k] = -1;
+        read_index[k] = -1;
+    }
+}
+
+
+Hw_counters::~Hw_counters()
+{
+    close();
+}
+
+
+bool Hw_counters::open()
+{
+    close();
+#ifdef __linux__
+    group_fd = open_counter(counter_configs[cycles], -1);
+    if (group_fd < 0) {
+        error_message = std::string("perf_event_open failed: ") + strerror(errno);
+        if (errno == EACCES || errno == EPERM)
+            error_message += " (see /proc/sys/kernel/perf_event_paranoid)";
+        else if (errno == ENOENT || errno == EOPNOTSUPP)
+            error_message += " (no hardware counters, e.g. in a virtual machine)";
+        return false;
+    }
+    fds[cycles] = group_fd;
+    read_index[cycles] = 0;
+    num_open = 1;
+    for (int k = 0; k < num_counters; k++) {
+        if (k == cycles)
+            continue;
+        fds[k] = open_counter(counter_configs[k], group_fd);
+        if (fds[k] >= 0)
+            read_index[k] = num_open++;
+    }
+    ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    if (ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0) {
+        error_message = std::string("Enabling the hardware counters failed: ") + strerror(errno);
+        close();
+        return false;
+    }
+    return true;
+#else
+    error_message = "Hardware counters are only supported on Linux";
+    return false;
+#endif
+}
+
+
+void Hw_counters::close()
+{
+#ifdef __linux__
+    for (int k = 0; k < num_counters; k++)
+        if (fds[k] >= 0 && fds[k] != group_fd)
+            ::close(fds[k]);
+    if (group_fd >= 0)
+        ::close(group_fd);
+#endif
+    group_fd = -1;
+    num_open = 0;
+    for (int k = 0; k < num_counters; k++) {
+        fds[k] = -1;
+        read_index[k] = -1;
+    }
+}
+
+
+bool Hw_counters::read(uint64_t values[]) const
+{
+    for (int k = 0; k < num_counters; k++)
+        values[k] = 0;
+#ifdef __linux__
+    if (group_fd < 0)
+        return false;
+    uint64_t data[1 + num_counters];   //the # of counters, then their values
+    const ssize_t size = ::read(group_fd, data, sizeof(data));
+    if (size < static_cast<ssize_t>((1 + num_open)*sizeof(uint64_t)))
+        return false;
+    for (int k = 0; k < num_counters; k++)
+        if (read_index[k] >= 0)
+            values[k] = data[1 + read_index[k]];
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+const char *Hw_counters::name(Counter counter)
+{
+    return counter_names[counter];
+}
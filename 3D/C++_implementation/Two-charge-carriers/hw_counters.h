@@ -0,0 +1,44 @@
+#ifndef HW_COUNTERS_H
+#define HW_COUNTERS_H
+
+#include <string>
+#include <cstdint>
+
+//!Hardware performance counters of the calling thread, read with Linux perf_event: cycles, instructions, last level cache
+//! misses and branch misses. They aren't always available (not Linux, a VM without a PMU, perf_event_paranoid > 2, ...);
+//! then open() returns false and error() says why, and the program should just go on without them.
+class Hw_counters
+{
+public:
+    enum Counter {cycles, instructions, llc_misses, branch_misses, num_counters};
+
+    Hw_counters();
+    ~Hw_counters();
+
+    //!Starts counting the calling thread (user space only). Returns false if the counters can't be used.
+    //! Counters other than cycles which aren't supported by the CPU are left out (see available()).
+    bool open();
+    void close();
+
+    bool is_open() const {return group_fd >= 0;}
+    bool available(Counter counter) const {return fds[counter] >= 0;}
+    const std::string &error() const {return error_message;}
+
+    //!Writes the counts since open() to \param values (num_counters entries, 0 for counters which aren't available).
+    //! Returns false if the counters couldn't be read.
+    bool read(uint64_t values[]) const;
+
+    static const char *name(Counter counter);
+
+private:
+    int group_fd;            //the cycles counter, the others are read with it; -1 if not open
+    int fds[num_counters];
+    int num_open;            //# of counters in the group
+    int read_index[num_counters];   //position of each counter in the group read, -1 if not available
+    std::string error_message;
+
+    Hw_counters(const Hw_counters&);
+    Hw_counters &operator=(const Hw_counters&);
+};
+
+#endif // HW_COUNTERS_H
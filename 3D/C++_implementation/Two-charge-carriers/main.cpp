@@ -44,12 +44,14 @@
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
 
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 #include <iomanip>
 #include <algorithm>   //allows to use fill and min
 #include <fstream>
 #include <chrono>
 #include <string>
+#include <memory>
 #include <time.h>
 #include <fstream>
 #include <string>
@@ -71,6 +73,25 @@
 #include "recombination.h"
 #include "photogeneration.h"
 #include "Utilities.h"
+#include "anderson_mix.h"
+#include "snapshot_file.h"
+#include "async_output.h"
+#include "vti_file.h"
+#include "output_policy.h"
+#include "phase_timer.h"
+
+//what is written at a voltage. Filled by the solver and written by the output thread.
+struct Va_output
+{
+    double Va, w, tolerance;
+    int iter;
+    bool write_JV;   //false for the equilibrium run
+    bool write_details, write_vti;
+    Convergence_record convergence;   //written with the JV line
+    Eigen::Tensor<double, 3> V, J_total_Z;
+    std::vector<double> p, n, Un;   //V, p, n and Un are only filled if the details or a VTI file are written
+    Eigen::Tensor<double, 3> J_total_X, J_total_Y;   //only filled if a VTI file is written
+};
 
 
 int main()
@@ -78,6 +99,12 @@ int main()
     std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();  //start clock timer
     Parameters params;    //params is struct storing all parameters
     params.Initialize();  //reads parameters from file
+    Phase_timers timers;
+    if (params.timing_report != "none") {
+        timers.activate();   //otherwise the TIME_PHASE scopes do nothing
+        if (params.hardware_counters)
+            timers.use_hardware_counters();   //prints why not if they aren't available, then only times
+    }
 
     const int num_cell = params.num_cell;   //create a local num_cell so don't have to type params.num_cell everywhere
 
@@ -89,6 +116,7 @@ int main()
 
     std::ofstream JV;
     JV.open("JV.txt");  //note: file will be created inside the build directory
+    std::ofstream convergence("convergence.txt");  //how the iterations converged at each voltage
 
     //-------------------------------------------------------------------------------------------------------
     //Initialize other vectors
@@ -119,6 +147,8 @@ int main()
     Continuity_n continuity_n(params);  //note this also sets up the constant top and bottom electrode BC's
     Photogeneration photogen(params, params.Photogen_scaling, params.GenRateFileName);
     Utilities utils;
+    utils.write_convergence_header(convergence);
+    Anderson_mix anderson(2, 1, num_rows, params.Anderson_depth);  //mixes n and p together, only used if mixing_method == 2
     Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::UpLoType::Lower, Eigen::AMDOrdering<int>> SCholesky; //Note using NaturalOrdering is much much slower
 
     Eigen::SparseQR<Eigen::SparseMatrix<double>, Eigen::COLAMDOrdering<int>> SQR;
@@ -179,6 +209,89 @@ int main()
     double error_np, old_error;  //this stores max value of the error and the value of max error from previous iteration
     std::vector<double> error_np_vector(num_rows+1);  //note: since n and p solutions are in vector form, can use vector form here also
 
+    //which voltages are written, and for the binary details and VTI files which fields and points
+    Output_policy policy = params.output_policy();
+    const bool write_fields = (params.details_output != 0 || params.vti_output != 0);
+    const bool keep_previous = write_fields && policy.keeps_previous();
+    Va_output previous_output;   //the fields of the previous voltage, if keep_previous
+
+    //x changes fastest. V and J include the boundaries, p, n and Un are the interior points only, in the order of the solution vectors
+    const uint32_t full = static_cast<uint32_t>(num_cell+1), interior = static_cast<uint32_t>(N);
+    const std::vector<uint32_t> full_dims = {full, full, full}, interior_dims = {interior, interior, interior};
+    const Output_region region = policy.select(full_dims, 0), interior_region = policy.select(interior_dims, 1);
+
+    //binary details file: V, p, n, J_total_Z and Un at each voltage
+    std::unique_ptr<Snapshot_writer> snapshots;
+    std::vector<int> snapshot_fields;   //indices of the fields written (in the order of names below)
+    std::vector<double> snapshot_scales;
+    std::vector<std::vector<double> > snapshot_buffers;
+    std::vector<const double*> snapshot_values;
+    const bool snapshot_interior[5] = {false, true, true, false, true};
+    if (params.details_output == 2) {
+        const char *names[5] = {"V", "p", "n", "J_total_Z", "Un"};
+        const double scales[5] = {Vt, params.N_dos, params.N_dos, 1, 1};
+        std::vector<Snapshot_array> arrays;
+        for (int k = 0; k < 5; k++) {
+            if (policy.has_field(names[k])) {
+                const Output_region &array_region = snapshot_interior[k] ? interior_region : region;
+                arrays.push_back({names[k], array_region.dims(), array_region.origin});
+                snapshot_fields.push_back(k);
+                snapshot_scales.push_back(scales[k]);
+            }
+        }
+        snapshot_buffers.resize(arrays.size());
+        snapshot_values.resize(arrays.size());
+        snapshots.reset(new Snapshot_writer("details.snap", arrays, region.spacing));
+    }
+
+    //the JV curve and details are written on a separate thread, while the next voltage is solved.
+    //This matters most in 3D, where copying the fields is much faster than writing them.
+    Parameters output_params = params;   //only used by the output thread
+    const std::vector<uint32_t> region_dims = region.dims();
+    Vti_writer vti({static_cast<int>(region_dims[0]), static_cast<int>(region_dims[1]), static_cast<int>(region_dims[2])},
+                   region.spacing, region.origin);
+    std::vector<double> p_grid, n_grid;   //p and n incl. the boundaries, for the VTI files
+    std::vector<std::vector<double> > vti_buffers(6);   //V, p, n, J_total_X, J_total_Y, J_total_Z
+    Async_output<Va_output> output([&](const Va_output &out) {
+        if (out.write_details && snapshots) {
+            const double *fields[5] = {out.V.data(), &out.p[1], &out.n[1], out.J_total_Z.data(), &out.Un[1]};
+            for (size_t f = 0; f < snapshot_fields.size(); f++) {
+                const int k = snapshot_fields[f];
+                if (snapshot_interior[k])
+                    interior_region.extract(fields[k], interior_dims, snapshot_buffers[f]);
+                else
+                    region.extract(fields[k], full_dims, snapshot_buffers[f]);
+                snapshot_values[f] = snapshot_buffers[f].data();
+            }
+            snapshots->write(out.Va, snapshot_values, snapshot_scales);
+        } else if (out.write_details) {
+            output_params.w = out.w;
+            output_params.tolerance = out.tolerance;
+            utils.write_details(output_params, out.Va, out.V, out.p, out.n, out.J_total_Z, out.Un);
+        }
+        if (out.write_vti) {
+            utils.to_grid(output_params, out.p, continuity_p.get_p_bottomBC(1,1), continuity_p.get_p_topBC(1,1), p_grid);
+            utils.to_grid(output_params, out.n, continuity_n.get_n_bottomBC(1,1), continuity_n.get_n_topBC(1,1), n_grid);
+            const double *fields[6] = {out.V.data(), p_grid.data(), n_grid.data(), out.J_total_X.data(), out.J_total_Y.data(), out.J_total_Z.data()};
+            for (int k = 0; k < 6; k++)
+                region.extract(fields[k], full_dims, vti_buffers[k]);
+            std::vector<Vti_array> arrays;
+            if (policy.has_field("V"))
+                arrays.push_back({"V", {vti_buffers[0].data()}, Vt});
+            if (policy.has_field("p"))
+                arrays.push_back({"p", {vti_buffers[1].data()}, output_params.N_dos});
+            if (policy.has_field("n"))
+                arrays.push_back({"n", {vti_buffers[2].data()}, output_params.N_dos});
+            if (policy.has_field("J_total"))
+                arrays.push_back({"J_total", {vti_buffers[3].data(), vti_buffers[4].data(), vti_buffers[5].data()}, 1.0});
+            vti.write("fields_" + std::to_string(out.Va) + ".vti", arrays, out.Va);
+        }
+        if (out.write_JV) {
+            utils.write_JV(output_params, JV, out.iter, out.Va, out.J_total_Z);
+            utils.write_convergence(convergence, out.convergence);
+        }
+    });
+
     for (Va_cnt = 0; Va_cnt <= num_V +1; Va_cnt++) {  //+1 b/c 1st Va is the equil run
         not_converged = false;
         not_cnv_cnt = 0;
@@ -199,6 +312,9 @@ int main()
             PhotogenRate = photogen.getPhotogenRate();    //otherwise PhotogenRate is pre-initialized to 0 in this main.cpp when declared
         }
         std::cout << "Va = " << Va <<std::endl;
+        timers.start_voltage(Va);
+        std::chrono::steady_clock::time_point Va_start = std::chrono::steady_clock::now();
+        int w_reductions = 0;
 
         //Reset top and bottom BCs (outside of loop b/c don't change iter to iter)
         poisson.set_V_bottomBC(params, Va);
@@ -207,22 +323,30 @@ int main()
         //-----------------------------------------------------------
         error_np = 1.0;
         iter = 0;
+        anderson.reset();  //history from the previous voltage is not useful
 
         while (error_np > params.tolerance) {
             //std::cout << "Va " << Va <<std::endl;
 
             //-----------------Solve Poisson Equation------------------------------------------------------------------     
-            poisson.set_rhs(n, p);  //this finds netcharge and sets rhs
+            {
+                TIME_PHASE(Phase::poisson_assembly);
+                poisson.set_rhs(n, p);  //this finds netcharge and sets rhs
+            }
             //std::cout << poisson.get_sp_matrix() << std::endl;
             oldV = V;
 
 
 
             if (iter == 0) { //INSTEAD OF HAVING IF here, can move these 2 lines, outside of the loop
+                TIME_PHASE(Phase::factorization);
                 poisson_LU.analyzePattern(poisson.get_sp_matrix());  //by doing only on first iter, since pattern never changes, save a bit cpu
                 poisson_LU.factorize(poisson.get_sp_matrix());
             }
-            soln_Xd = poisson_LU.solve(poisson.get_rhs());
+            {
+                TIME_PHASE(Phase::poisson_solve);
+                soln_Xd = poisson_LU.solve(poisson.get_rhs());
+            }
 
 
 /*
@@ -241,10 +365,14 @@ int main()
             }
 
             //Mix old and new solutions for V
-            if (iter > 0)
-                V  = utils.linear_mix(params, newV, oldV);
-            else
-                V = newV;
+            //(for Anderson mixing V is not mixed, so that V is a function of n and p only and the Gummel iteration is a fixed point map for n and p)
+            {
+                TIME_PHASE(Phase::mixing);
+                if (iter > 0 && params.mixing_method == 1)
+                    utils.linear_mix(params, newV, oldV, V);
+                else
+                    V = newV;
+            }
 
             //update side BC's and V_matrix
             poisson.set_V_leftBC_X(V);
@@ -259,6 +387,7 @@ int main()
             //FOR NOW CAN USE 0 FOR R_Langevin
 
             if (Va_cnt > 0) {
+                TIME_PHASE(Phase::continuity_assembly);
                 for (int i = 1; i <= num_rows; i++) {
                     Un[i] = params.Photogen_scaling;  //This is what was used in Matlab version for testing.   photogen.getPhotogenRate()(i,j); //- R_Langevin(i,j);
                 }
@@ -267,15 +396,24 @@ int main()
 
             //--------------------------------Solve equations for n and p------------------------------------------------------------ 
 
-            continuity_n.setup_eqn(poisson.get_V_matrix(), Un, n);
+            {
+                TIME_PHASE(Phase::continuity_assembly);
+                continuity_n.setup_eqn(poisson.get_V_matrix(), Un, n);
+            }
             oldn = n;
 
             //std::chrono::high_resolution_clock::time_point start2 = std::chrono::high_resolution_clock::now();  //start clock timer
 
-            if (iter == 0 ) //can move this outside of the loop, instead of using if here...
-                cont_n_LU.analyzePattern(continuity_n.get_sp_matrix());  //by doing only on first iter, since pattern never changes, save a bit cpu
-            cont_n_LU.factorize(continuity_n.get_sp_matrix());  //need to do on each iter, b/c matrix elements change
-            soln_Xd = cont_n_LU.solve(continuity_n.get_rhs());
+            {
+                TIME_PHASE(Phase::factorization);
+                if (iter == 0 ) //can move this outside of the loop, instead of using if here...
+                    cont_n_LU.analyzePattern(continuity_n.get_sp_matrix());  //by doing only on first iter, since pattern never changes, save a bit cpu
+                cont_n_LU.factorize(continuity_n.get_sp_matrix());  //need to do on each iter, b/c matrix elements change
+            }
+            {
+                TIME_PHASE(Phase::solve);
+                soln_Xd = cont_n_LU.solve(continuity_n.get_rhs());
+            }
 
             //std::chrono::high_resolution_clock::time_point finish2 = std::chrono::high_resolution_clock::now();
             //std::chrono::duration<double> time2 = std::chrono::duration_cast<std::chrono::duration<double>>(finish2-start2);
@@ -301,7 +439,10 @@ int main()
             }
 
             //-------------------------------------------------------
-            continuity_p.setup_eqn(poisson.get_V_matrix(), Up, p);
+            {
+                TIME_PHASE(Phase::continuity_assembly);
+                continuity_p.setup_eqn(poisson.get_V_matrix(), Up, p);
+            }
             //std::cout << continuity_p.get_sp_matrix() << std::endl;   //Note: get rhs, returns an Eigen VectorXd
             oldp = p;
 /*
@@ -313,10 +454,16 @@ int main()
             soln_Xd = BiCGStab_solver.solve(continuity_p.get_rhs());
 */
 
-            if (iter == 0 )
-                cont_p_LU.analyzePattern(continuity_p.get_sp_matrix());
-            cont_p_LU.factorize(continuity_p.get_sp_matrix());
-            soln_Xd = cont_p_LU.solve(continuity_p.get_rhs());
+            {
+                TIME_PHASE(Phase::factorization);
+                if (iter == 0 )
+                    cont_p_LU.analyzePattern(continuity_p.get_sp_matrix());
+                cont_p_LU.factorize(continuity_p.get_sp_matrix());
+            }
+            {
+                TIME_PHASE(Phase::solve);
+                soln_Xd = cont_p_LU.solve(continuity_p.get_rhs());
+            }
 
 
             //save results back into n std::vector. RECALL, I am starting my V vector from index of 1, corresponds to interior pts...
@@ -326,6 +473,7 @@ int main()
 
             //------------------------------------------------
 
+            TIME_PHASE(Phase::mixing);   //the rest of the iteration
             //if get negative p's or n's set them = 0
             for (int i = 1; i <= num_rows; i++) {
                 if (newp[i] < 0.0) newp[i] = 0;
@@ -350,11 +498,21 @@ int main()
             if (not_cnv_cnt > 2000) {
                 params.reduce_w();
                 params.relax_tolerance();
+                w_reductions++;
                 not_cnv_cnt = 0;
+                anderson.reset();  //history was built with the old w
             }
 
-            p = utils.linear_mix(params, newp, oldp);
-            n = utils.linear_mix(params, newn, oldn);
+            if (params.mixing_method == 2) {
+                anderson.set_field(0, newn, oldn);
+                anderson.set_field(1, newp, oldp);
+                anderson.mix(params);
+                anderson.get_result(0, n);
+                anderson.get_result(1, p);
+            } else {
+                utils.linear_mix(params, newp, oldp, p);
+                utils.linear_mix(params, newn, oldn, n);
+            }
 
             //Apply side continuity equation  BC's
             //WE ARE UPDATING BC'S here b/c we need them for setting up the n and p matrices below
@@ -390,17 +548,71 @@ int main()
         J_total_Y = continuity_p.get_Jp_Y() + continuity_n.get_Jn_Y();
 
         //---------------------Write to file----------------------------------------------------------------
-        utils.write_details(params, Va, poisson.get_V_matrix(), p, n, J_total_Z, Un);
-        if(Va_cnt >0) utils.write_JV(params, JV, iter, Va, J_total_Z);
+        const double Va_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - Va_start).count();
+        TIME_PHASE(Phase::output);
+        bool write_previous = false, write_current = false;
+        if (Va_cnt > 0 && write_fields) {
+            const int i = static_cast<int>(floor(params.num_cell/2));   //where the JV curve's current is taken
+            policy.next_voltage(Va, J_total_Z(i,i,i), write_previous, write_current);
+        }
+        auto fill = [&](Va_output &out, bool with_fields) {   //the copies reuse the record's buffers
+            out.Va = Va;
+            out.w = params.w;
+            out.tolerance = params.tolerance;
+            out.iter = iter;
+            out.write_JV = (Va_cnt > 0);
+            out.write_details = write_current && params.details_output != 0;
+            out.write_vti = write_current && params.vti_output != 0;
+            out.convergence = {Va, iter, error_np, params.w, params.tolerance, w_reductions, Va_time};
+            out.J_total_Z = J_total_Z;
+            if (with_fields) {
+                out.V = poisson.get_V_matrix();
+                out.p = p;
+                out.n = n;
+                out.Un = Un;
+                out.J_total_X = J_total_X;
+                out.J_total_Y = J_total_Y;
+            }
+        };
+
+        if (write_previous) {   //Voc or the MPP was at the previous voltage
+            Va_output &out = output.acquire();
+            out = previous_output;
+            out.write_JV = false;
+            out.write_details = (params.details_output != 0);
+            out.write_vti = (params.vti_output != 0);
+            output.submit();
+        }
+        fill(output.acquire(), write_current);
+        output.submit();
+        if (keep_previous)
+            fill(previous_output, true);
+        timers.end_voltage(iter);
 
 
     }//end of main loop
 
+    {
+        TIME_PHASE(Phase::output);
+        output.finish();
+    }
     JV.close();
+    convergence.close();
+    if (snapshots) {
+        try {
+            snapshots->close();
+        }
+        catch (std::runtime_error &e) {   //details.snap is incomplete
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
 
     std::chrono::high_resolution_clock::time_point finish = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> time = std::chrono::duration_cast<std::chrono::duration<double>>(finish-start);
     std::cout << "CPU time = " << time.count() << std::endl;
+    if (params.timing_report != "none")
+        timers.write_report(params.timing_report, "3D", num_cell);
 
     return 0;
 }
@@ -0,0 +1,206 @@
+#include "output_policy.h"
+
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+    std::vector<std::string> split(const std::string &text, char separator)
+    {
+        std::vector<std::string> parts;
+        std::istringstream stream(text);
+        std::string part;
+        while (std::getline(stream, part, separator))
+            if (!part.empty())
+                parts.push_back(part);
+        return parts;
+    }
+
+    //converts all of \param text to a number, or throws
+    double to_number(const std::string &text, const std::string &what)
+    {
+        char *end = nullptr;
+        double value = strtod(text.c_str(), &end);
+        if (text.empty() || *end != '\0')
+            throw std::runtime_error("Invalid " + what + ": " + text);
+        return value;
+    }
+
+    int to_index(const std::string &text, const std::string &what)
+    {
+        double value = to_number(text, what);
+        if (value < 0 || value != std::floor(value))
+            throw std::runtime_error("Invalid " + what + ": " + text + " (must be a grid index >= 0)");
+        return static_cast<int>(value);
+    }
+}
+
+
+std::vector<uint32_t> Output_region::dims() const
+{
+    std::vector<uint32_t> result(indices.size());
+    for (size_t d = 0; d < indices.size(); d++)
+        result[d] = static_cast<uint32_t>(indices[d].size());
+    return result;
+}
+
+
+uint64_t Output_region::size() const
+{
+    uint64_t n = 1;
+    for (size_t d = 0; d < indices.size(); d++)
+        n *= indices[d].size();
+    return n;
+}
+
+
+void Output_region::extract(const double *values, const std::vector<uint32_t> &full_dims, std::vector<double> &result) const
+{
+    result.resize(size());
+    if (result.empty())
+        return;
+
+    //index of the full array = i0 + full_dims[0]*(i1 + full_dims[1]*i2). Loop over the kept points, 1st axis fastest.
+    const size_t num_dims = indices.size();
+    std::vector<size_t> pos(num_dims, 0);
+    for (uint64_t k = 0; k < result.size(); k++) {
+        uint64_t index = 0;
+        for (size_t d = num_dims; d-- > 0; )
+            index = index*full_dims[d] + indices[d][pos[d]];
+        result[k] = values[index];
+
+        for (size_t d = 0; d < num_dims; d++) {
+            if (++pos[d] < indices[d].size())
+                break;
+            pos[d] = 0;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------------------------------
+Output_policy::Output_policy(const std::string &voltages, const std::string &field_list, const std::string &region, int decimation,
+                             const std::vector<std::string> &field_names, const std::vector<std::string> &axis_names, double increment, double dx)
+    : all_voltages(false), Voc(false), MPP(false), stride(0), increment(increment), dx(dx), decimation(decimation),
+      Va_cnt(0), previous_J(0), previous_power(0), before_previous_power(0), previous_written(false), MPP_found(false)
+{
+    //voltages
+    std::vector<std::string> parts = split(voltages, '+');
+    if (parts.empty())
+        throw std::runtime_error("Invalid output_voltages: " + voltages);
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (parts[i] == "all")
+            all_voltages = true;
+        else if (parts[i] == "Voc")
+            Voc = true;
+        else if (parts[i] == "MPP")
+            MPP = true;
+        else if (parts[i].compare(0, 7, "stride:") == 0) {
+            stride = static_cast<int>(to_number(parts[i].substr(7), "output_voltages stride"));
+            if (stride < 1)
+                throw std::runtime_error("Invalid output_voltages: the stride must be >= 1.");
+        }
+        else if (parts[i].compare(0, 5, "list:") == 0) {
+            std::vector<std::string> values = split(parts[i].substr(5), ',');
+            for (size_t v = 0; v < values.size(); v++)
+                list.push_back(to_number(values[v], "output_voltages list entry"));
+        }
+        else
+            throw std::runtime_error("Invalid output_voltages: " + parts[i] + " (must be all, stride:k, list:Va1,Va2,..., Voc or MPP)");
+    }
+
+    //fields
+    if (field_list != "all") {
+        fields = split(field_list, ',');
+        for (size_t i = 0; i < fields.size(); i++)
+            if (std::find(field_names.begin(), field_names.end(), fields[i]) == field_names.end())
+                throw std::runtime_error("Invalid output_fields: unknown field " + fields[i]);
+        if (fields.empty())
+            throw std::runtime_error("Invalid output_fields: " + field_list);
+    }
+
+    //region
+    region_begin.assign(axis_names.size(), -1);
+    region_end.assign(axis_names.size(), -1);
+    if (region != "all") {
+        std::vector<std::string> ranges = split(region, ',');
+        for (size_t i = 0; i < ranges.size(); i++) {
+            size_t equal = ranges[i].find('=');
+            std::vector<std::string>::const_iterator axis = std::find(axis_names.begin(), axis_names.end(), ranges[i].substr(0, equal));
+            if (equal == std::string::npos || axis == axis_names.end())
+                throw std::runtime_error("Invalid output_region: " + ranges[i]);
+            const size_t d = axis - axis_names.begin();
+
+            std::string range = ranges[i].substr(equal + 1);
+            size_t colon = range.find(':');
+            region_begin[d] = to_index(range.substr(0, colon), "output_region");
+            region_end[d] = (colon == std::string::npos) ? region_begin[d] : to_index(range.substr(colon + 1), "output_region");
+            if (region_end[d] < region_begin[d])
+                throw std::runtime_error("Invalid output_region: " + ranges[i] + " (the end is before the start)");
+        }
+    }
+
+    if (decimation < 1)
+        throw std::runtime_error("Invalid input. output_decimation must be >= 1.");
+}
+
+
+void Output_policy::next_voltage(double Va, double J, bool &write_previous, bool &write_current)
+{
+    write_previous = false;
+    write_current = all_voltages || (stride > 0 && Va_cnt % stride == 0);
+    for (size_t i = 0; i < list.size() && !write_current; i++)
+        write_current = std::fabs(Va - list[i]) < 0.5*increment*(1 + 1e-9);
+
+    //the current changes sign between the previous voltage and this one
+    if (Voc && Va_cnt > 0 && ((previous_J < 0 && J >= 0) || (previous_J > 0 && J <= 0))) {
+        write_previous = true;
+        write_current = true;
+    }
+
+    //the generated power -Va*J has its maximum at the previous voltage
+    const double power = -Va*J;
+    if (MPP && !MPP_found && Va_cnt > 0 && previous_power > 0 && previous_power >= power
+            && (Va_cnt == 1 || previous_power > before_previous_power)) {
+        write_previous = true;
+        MPP_found = true;
+    }
+
+    if (previous_written)
+        write_previous = false;  //already written
+
+    previous_written = write_current;
+    before_previous_power = previous_power;
+    previous_power = power;
+    previous_J = J;
+    Va_cnt++;
+}
+
+
+bool Output_policy::has_field(const std::string &name) const
+{
+    return fields.empty() || std::find(fields.begin(), fields.end(), name) != fields.end();
+}
+
+
+Output_region Output_policy::select(const std::vector<uint32_t> &dims, int first_index) const
+{
+    Output_region result;
+    result.spacing = dx*decimation;
+    result.indices.resize(dims.size());
+    result.origin.resize(dims.size());
+    for (size_t d = 0; d < dims.size(); d++) {
+        //the region in indices of this array
+        int begin = 0, end = static_cast<int>(dims[d]) - 1;
+        if (d < region_begin.size() && region_begin[d] >= 0) {
+            begin = std::max(begin, region_begin[d] - first_index);
+            end = std::min(end, region_end[d] - first_index);
+        }
+        for (int i = begin; i <= end; i += decimation)
+            result.indices[d].push_back(static_cast<uint32_t>(i));
+        result.origin[d] = dx*(first_index + begin);
+    }
+    return result;
+}
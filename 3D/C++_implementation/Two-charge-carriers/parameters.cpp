@@ -64,6 +64,25 @@ void Parameters::Initialize()
         parameters >> tol_relax_factor >> comment;
         isPositive(tol_relax_factor,comment);
         parameters >> GenRateFileName >> comment;
+        parameters >> comment;  //skip line which categorizes the solver params
+        parameters >> mixing_method >> comment;
+        if (mixing_method != 1 && mixing_method != 2)
+            throw std::runtime_error("Invalid input. mixing_method must be 1 (linear) or 2 (Anderson).");
+        parameters >> Anderson_depth >> comment;
+        isPositive(Anderson_depth, comment);
+        parameters >> details_output >> comment;
+        if (details_output < 0 || details_output > 2)
+            throw std::runtime_error("Invalid input. details_output must be 0 (none), 1 (text files) or 2 (binary snapshot file).");
+        parameters >> vti_output >> comment;
+        if (vti_output != 0 && vti_output != 1)
+            throw std::runtime_error("Invalid input. vti_output must be 0 or 1.");
+        parameters >> output_voltages >> comment;
+        parameters >> output_fields >> comment;
+        parameters >> output_region >> comment;
+        parameters >> output_decimation >> comment;
+        parameters >> timing_report >> comment;
+        parameters >> hardware_counters >> comment;
+        output_policy();  //throws if the output specifications are invalid
         parameters.close();
         N_dos = N_HOMO;     //scaling factor helps CV be on order of 1
 
@@ -114,3 +133,10 @@ void Parameters::isNegative(int input, const std::string &comment)
     }
 
 }
+
+
+Output_policy Parameters::output_policy() const
+{
+    return Output_policy(output_voltages, output_fields, output_region, output_decimation,
+                         {"V", "p", "n", "J_total_Z", "Un", "J_total"}, {"x", "y", "z"}, increment, dx);
+}
@@ -8,6 +8,8 @@
 #include <iostream>
 #include <iomanip>
 
+#include "output_policy.h"
+
 
 struct Parameters   //parameters need to be accessble, so all members are public.
 {
@@ -40,6 +42,19 @@ struct Parameters   //parameters need to be accessble, so all members are public
     double L;
     int num_cell, num_elements;  //num_elements = (num_cell-1)^3
     std::string GenRateFileName;
+    int mixing_method;   //1 = linear mixing, 2 = Anderson acceleration
+    int Anderson_depth;  //# of previous iterations used for Anderson mixing
+    int details_output;  //V, n, p etc. at each voltage: 0 = none, 1 = a text file per voltage (line profile), 2 = binary file details.snap (full fields)
+    int vti_output;      //1 = write V, n, p and J as a VTK ImageData (.vti) file at each voltage selected by output_voltages, 0 = never
+
+    //what of the details and VTI files is written (see Output_policy)
+    std::string output_voltages;  //all, stride:k, list:Va1,Va2,..., Voc, MPP, combined with +
+    std::string output_fields;    //all, or a comma separated list of V, p, n, J_total_Z, Un (binary details) and J_total (VTI)
+    std::string output_region;    //all, or grid index ranges / slice planes, e.g. x=10:90,z=0:50,y=20 (binary details and VTI only)
+    int output_decimation;        //only every output_decimation'th point along each axis is written (binary details and VTI only)
+    std::string timing_report;    //JSON file with the time of each solver phase per voltage, "none" = off
+    bool hardware_counters;       //add the hardware counters of each phase to the timing report (see Hw_counters)
+    Output_policy output_policy() const;
     double Va_min, Va_max, increment;
     double Vbi;
 
@@ -0,0 +1,119 @@
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+#include <vector>
+#include <string>
+#include <chrono>
+
+#include "hw_counters.h"
+
+//!The parts of the solver which are timed separately
+enum class Phase
+{
+    poisson_assembly,      //Poisson rhs (and matrix)
+    poisson_solve,
+    bernoulli,             //Bernoulli functions of the continuity equations
+    continuity_assembly,   //continuity matrices and rhs, net generation rate
+    factorization,         //LU/Cholesky factorizations, preconditioners
+    solve,                 //continuity equation solves
+    mixing,                //error, mixing of the old and new solutions
+    output,                //handing the results of a voltage to the output
+    num_phases
+};
+
+
+//!Accumulates the time spent in each Phase, per voltage and for the whole run, and writes it as a JSON report.
+//! The times are exclusive: a phase timed inside another (e.g. bernoulli inside continuity_assembly) is not counted in the
+//! outer one. The time of a voltage which is in no phase (e.g. the currents) is reported as "other".
+//! The phases are timed with the TIME_PHASE macro, which times the rest of the enclosing scope for the Phase_timers
+//! activated on the calling thread, so the solver classes don't need a reference to the timers. It does nothing if no timers
+//! are activated, and if DD_NO_TIMERS is defined it is compiled out completely.
+//! Optionally the hardware counters (Hw_counters) of each phase are counted too, to see if a phase is compute or memory bound.
+class Phase_timers
+{
+public:
+    Phase_timers();
+    ~Phase_timers();
+
+    //!Phases timed on the calling thread are added to these timers, until deactivate() or the destructor
+    void activate();
+    void deactivate();
+
+    //!Also counts cycles, instructions, cache and branch misses of each phase, for the whole run. The counters count the
+    //! calling thread, so call this on the thread that is timed. Prints why and returns false if they aren't available.
+    bool use_hardware_counters();
+
+    //!The timers activated on the calling thread, or null
+    static Phase_timers *active();
+
+    //!Starts and ends the record of one voltage (\param Va) of the sweep, needing \param iterations
+    void start_voltage(double Va);
+    void end_voltage(int iterations);
+
+    //!Makes \param phase the current phase and returns the previous one (num_phases = none). \param count: count a call of phase.
+    Phase enter(Phase phase, bool count = true);
+
+    //!Writes the report to \param file_name. \param engine and \param num_cell describe the run (e.g. "1D", 300).
+    //! Prints an error and returns false if the file can't be written.
+    bool write_report(const std::string &file_name, const std::string &engine, int num_cell) const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Voltage_record
+    {
+        double Va;
+        int iterations;
+        double time;                  //wall time of the voltage in s
+        std::vector<double> phases;   //time in each phase in s
+    };
+
+    Clock::time_point run_start, phase_start, voltage_start;
+    Phase current;
+    bool in_voltage;
+    std::vector<double> run_times;    //time in each phase in s, for the whole run
+    std::vector<long long> calls;     //# of times each phase was entered
+    std::vector<Voltage_record> voltages;
+
+    Hw_counters hw_counters;
+    std::string hw_status;                          //"off", "on" or why they aren't available
+    std::vector<std::vector<uint64_t> > hw_counts;  //[phase][counter], for the whole run
+    uint64_t last_hw_counts[Hw_counters::num_counters];
+
+    void charge_current(Clock::time_point now);   //adds the time since phase_start to the current phase
+};
+
+
+//!Times the rest of the enclosing scope as \param phase (see TIME_PHASE)
+class Scoped_phase
+{
+public:
+    explicit Scoped_phase(Phase phase) : timers(Phase_timers::active())
+    {
+        if (timers)
+            previous = timers->enter(phase);
+    }
+    ~Scoped_phase()
+    {
+        if (timers)
+            timers->enter(previous, false);
+    }
+
+private:
+    Phase_timers *timers;
+    Phase previous;
+
+    Scoped_phase(const Scoped_phase&);
+    Scoped_phase &operator=(const Scoped_phase&);
+};
+
+
+#define PHASE_TIMER_CONCAT_(a, b) a##b
+#define PHASE_TIMER_CONCAT(a, b) PHASE_TIMER_CONCAT_(a, b)
+#ifdef DD_NO_TIMERS
+#define TIME_PHASE(phase)
+#else
+#define TIME_PHASE(phase) Scoped_phase PHASE_TIMER_CONCAT(scoped_phase_, __LINE__)(phase)
+#endif
+
+#endif // PHASE_TIMER_H
@@ -21,7 +21,7 @@ public:
     //! \param photogen_scaling is the scaling factor obtained from fit to get the correct short-circuit current.
     Photogeneration(const Parameters &params, double photogen_scaling, const std::string gen_rate_file_name);
 
-    Eigen::MatrixXd getPhotogenRate() {return PhotogenRate;}
+    const Eigen::MatrixXd &getPhotogenRate() const {return PhotogenRate;}
 
 private:
     Eigen::MatrixXd PhotogenRate;
@@ -40,11 +40,11 @@ public:
     void set_V_rightBC_Y(const std::vector<double> &V);
 
     //getters
-    Eigen::VectorXd get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
-    Eigen::SparseMatrix<double> get_sp_matrix() const {return sp_matrix;}
+    const Eigen::VectorXd &get_rhs() const {return VecXd_rhs;}  //returns the Eigen object
+    const Eigen::SparseMatrix<double> &get_sp_matrix() const {return sp_matrix;}
     double get_V_topBC(int i, int j) const {return V_topBC(i,j);}    //top and bottom  bc getters are needed to determine initial V
     double get_V_bottomBC(int i, int j) const {return V_bottomBC(i,j);}
-    Eigen::Tensor<double, 3> get_V_matrix() const {return V_matrix;}
+    const Eigen::Tensor<double, 3> &get_V_matrix() const {return V_matrix;}
 
     //The below getters can be useful for testing and debugging
     //std::vector<double> get_main_diag() const {return main_diag;}
@@ -0,0 +1,250 @@
+#include "snapshot_file.h"
+
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    const char header_magic[8] = {'D', 'D', 'S', 'N', 'A', 'P', '0', '2'};
+    const char index_magic[8] = {'D', 'D', 'S', 'N', 'I', 'D', 'X', '1'};
+
+    bool little_endian()
+    {
+        const uint16_t one = 1;
+        return *reinterpret_cast<const unsigned char*>(&one) == 1;
+    }
+
+    void swap_bytes(void *data, size_t size)
+    {
+        unsigned char *bytes = static_cast<unsigned char*>(data);
+        std::reverse(bytes, bytes + size);
+    }
+
+    //write/read n values of type T, converting to/from little endian if needed
+    template<typename T> void write_values(std::ofstream &file, const T *values, size_t n)
+    {
+        if (little_endian()) {
+            file.write(reinterpret_cast<const char*>(values), n*sizeof(T));
+            return;
+        }
+        for (size_t i = 0; i < n; i++) {
+            T value = values[i];
+            swap_bytes(&value, sizeof(T));
+            file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    }
+
+    template<typename T> void write_value(std::ofstream &file, T value) {write_values(file, &value, 1);}
+
+    template<typename T> void read_values(std::ifstream &file, T *values, size_t n)
+    {
+        if (!file.read(reinterpret_cast<char*>(values), n*sizeof(T)))
+            throw std::runtime_error("Snapshot file is truncated.");
+        if (!little_endian())
+            for (size_t i = 0; i < n; i++)
+                swap_bytes(&values[i], sizeof(T));
+    }
+
+    template<typename T> T read_value(std::ifstream &file)
+    {
+        T value;
+        read_values(file, &value, 1);
+        return value;
+    }
+}
+
+
+uint64_t Snapshot_array::size() const
+{
+    uint64_t n = 1;
+    for (size_t d = 0; d < dims.size(); d++)
+        n *= dims[d];
+    return n;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------------------
+Snapshot_writer::Snapshot_writer(const std::string &file_name, const std::vector<Snapshot_array> &arrays, double spacing)
+    : file(file_name, std::ios::binary | std::ios::trunc), file_name(file_name), arrays(arrays)
+{
+    if (!file)
+        throw std::runtime_error("Unable to open file " + file_name);
+
+    uint64_t record_size = 0;
+    for (size_t k = 0; k < arrays.size(); k++)
+        record_size += arrays[k].size();
+    buffer.resize(record_size);
+
+    file.write(header_magic, sizeof(header_magic));
+    write_value<double>(file, spacing);
+    write_value<uint32_t>(file, static_cast<uint32_t>(arrays.size()));
+    for (size_t k = 0; k < arrays.size(); k++) {
+        write_value<uint32_t>(file, static_cast<uint32_t>(arrays[k].name.size()));
+        file.write(arrays[k].name.data(), arrays[k].name.size());
+        write_value<uint32_t>(file, static_cast<uint32_t>(arrays[k].dims.size()));
+        write_values(file, arrays[k].dims.data(), arrays[k].dims.size());
+        if (arrays[k].origin.size() != arrays[k].dims.size())
+            throw std::runtime_error("Snapshot array " + arrays[k].name + " needs one origin per dim.");
+        write_values(file, arrays[k].origin.data(), arrays[k].origin.size());
+    }
+    if (!file)
+        throw std::runtime_error("Unable to write file " + file_name);
+}
+
+
+Snapshot_writer::~Snapshot_writer()
+{
+    if (file.is_open()) {
+        try {
+            close();
+        }
+        catch (std::exception &e) {   //a destructor can't throw; close() should be called explicitly to find out
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
+
+
+void Snapshot_writer::write(double Va, const std::vector<const double*> &values, const std::vector<double> &scales)
+{
+    if (!file)
+        return;   //a write already failed (reported then, and again by close)
+
+    size_t pos = 0;
+    for (size_t k = 0; k < arrays.size(); k++) {
+        const size_t n = arrays[k].size();
+        for (size_t i = 0; i < n; i++)
+            buffer[pos + i] = scales[k]*values[k][i];
+        pos += n;
+    }
+
+    voltages.push_back(Va);
+    offsets.push_back(static_cast<uint64_t>(file.tellp()));
+    write_value<double>(file, Va);
+    write_values(file, buffer.data(), buffer.size());
+    if (!file)
+        throw std::runtime_error("Unable to write file " + file_name);
+}
+
+
+void Snapshot_writer::close()
+{
+    uint64_t index_offset = static_cast<uint64_t>(file.tellp());
+    write_value<uint64_t>(file, voltages.size());
+    for (size_t r = 0; r < voltages.size(); r++) {
+        write_value<double>(file, voltages[r]);
+        write_value<uint64_t>(file, offsets[r]);
+    }
+    write_value<uint64_t>(file, index_offset);
+    file.write(index_magic, sizeof(index_magic));
+    file.close();
+    if (!file)   //also set if a record couldn't be written
+        throw std::runtime_error("Unable to write file " + file_name);
+}
+
+
+//--------------------------------------------------------------------------------------------------------------------------
+Snapshot_reader::Snapshot_reader(const std::string &file_name) : file(file_name, std::ios::binary)
+{
+    if (!file)
+        throw std::runtime_error("Unable to open file " + file_name);
+
+    file.seekg(0, std::ios::end);
+    const uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    //the sizes read from the file are checked against the bytes left, so a damaged file can't make them huge
+    auto bytes_left = [&]() {return file_size - static_cast<uint64_t>(file.tellg());};
+
+    char magic[8];
+    if (!file.read(magic, sizeof(magic)))
+        throw std::runtime_error(file_name + " is not a snapshot file.");
+    if (memcmp(magic, header_magic, sizeof(magic)) != 0)
+        throw std::runtime_error(file_name + " is not a snapshot file.");
+
+    spacing = read_value<double>(file);
+    uint32_t num_arrays = read_value<uint32_t>(file);
+    uint64_t record_size = 0;
+    for (uint32_t k = 0; k < num_arrays; k++) {
+        Snapshot_array array;
+        const uint32_t name_size = read_value<uint32_t>(file);
+        if (name_size > bytes_left())
+            throw std::runtime_error("Snapshot file is damaged.");
+        array.name.resize(name_size);
+        if (!array.name.empty() && !file.read(&array.name[0], array.name.size()))
+            throw std::runtime_error("Snapshot file is truncated.");
+        const uint32_t num_dims = read_value<uint32_t>(file);
+        if (num_dims > bytes_left()/sizeof(uint32_t))
+            throw std::runtime_error("Snapshot file is damaged.");
+        array.dims.resize(num_dims);
+        read_values(file, array.dims.data(), array.dims.size());
+        array.origin.resize(array.dims.size());
+        read_values(file, array.origin.data(), array.origin.size());
+        //a record can't be larger than the file, so the size is capped at file_size (then no record fits, instead of overflowing)
+        uint64_t array_size = 1;
+        for (size_t d = 0; d < array.dims.size(); d++)
+            array_size = (array.dims[d] != 0 && array_size > file_size/array.dims[d]) ? file_size : array_size*array.dims[d];
+        record_size = std::min(record_size + array_size, file_size);
+        arrays.push_back(array);
+    }
+    const uint64_t first_record = static_cast<uint64_t>(file.tellg());
+    const uint64_t record_bytes = sizeof(double)*(1 + record_size);
+
+    //use the index, if the file has one
+    if (file_size >= first_record + 16) {
+        file.seekg(file_size - 16);
+        uint64_t index_offset = read_value<uint64_t>(file);
+        if (file.read(magic, sizeof(magic)) && memcmp(magic, index_magic, sizeof(magic)) == 0 && index_offset < file_size) {
+            if (index_offset < first_record || index_offset + sizeof(uint64_t) > file_size - 16)
+                throw std::runtime_error("Snapshot file is damaged.");
+            file.seekg(index_offset);
+            uint64_t num_records = read_value<uint64_t>(file);
+            if (num_records > (file_size - 16 - static_cast<uint64_t>(file.tellg()))/(sizeof(double) + sizeof(uint64_t)))
+                throw std::runtime_error("Snapshot file is damaged.");
+            for (uint64_t r = 0; r < num_records; r++) {
+                voltages.push_back(read_value<double>(file));
+                offsets.push_back(read_value<uint64_t>(file));
+                if (offsets.back() < first_record || offsets.back() > index_offset || record_bytes > index_offset - offsets.back())
+                    throw std::runtime_error("Snapshot file is damaged.");
+            }
+            return;
+        }
+    }
+
+    //no index (the writer didn't finish): the complete records follow the header
+    file.clear();
+    for (uint64_t offset = first_record; offset + record_bytes <= file_size; offset += record_bytes) {
+        file.seekg(offset);
+        voltages.push_back(read_value<double>(file));
+        offsets.push_back(offset);
+    }
+}
+
+
+size_t Snapshot_reader::find(double Va) const
+{
+    if (voltages.empty())
+        throw std::runtime_error("Snapshot file has no snapshots.");
+
+    size_t nearest = 0;
+    for (size_t r = 1; r < voltages.size(); r++)
+        if (std::fabs(voltages[r] - Va) < std::fabs(voltages[nearest] - Va))
+            nearest = r;
+    return nearest;
+}
+
+
+void Snapshot_reader::read(size_t index, std::vector<std::vector<double> > &values)
+{
+    if (index >= offsets.size())
+        throw std::runtime_error("Invalid snapshot index.");
+
+    file.clear();
+    file.seekg(offsets[index] + sizeof(double));  //skip Va
+    values.resize(arrays.size());
+    for (size_t k = 0; k < arrays.size(); k++) {
+        values[k].resize(arrays[k].size());
+        read_values(file, values[k].data(), values[k].size());
+    }
+}
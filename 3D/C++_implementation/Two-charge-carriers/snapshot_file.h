@@ -0,0 +1,77 @@
+#ifndef SNAPSHOT_FILE_H
+#define SNAPSHOT_FILE_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+//!Layout of a snapshot file (all values little endian):
+//!  header:  "DDSNAP02", spacing (double, distance between the points), # of arrays (uint32), and for each array: name (uint32
+//!           length + chars), # of dims (uint32), the dims (uint32 each, the 1st index changes fastest) and the origin along each
+//!           axis (double each, the coordinate of index 0, so the coordinate of index i along axis d is origin[d] + spacing*i).
+//!  records: for each voltage: Va (double), then the values of each array (doubles), in the order of the header
+//!  index:   # of records (uint64), and for each: Va (double) and the file offset of the record (uint64)
+//!  footer:  file offset of the index (uint64), "DDSNIDX1"
+//! The index and footer are written when the file is closed. All records have the same size, so the records of a file
+//! without index (e.g. from a killed run) can still be found.
+struct Snapshot_array
+{
+    std::string name;
+    std::vector<uint32_t> dims;
+    std::vector<double> origin;   //one per dim
+    uint64_t size() const;  //# of values
+};
+
+
+//!Writes the fields (V, n, p, J, etc.) at each voltage into one binary file, instead of one text file per voltage.
+class Snapshot_writer
+{
+public:
+    //!Creates \param file_name. \param arrays describes the arrays written at each voltage, \param spacing is the mesh spacing.
+    Snapshot_writer(const std::string &file_name, const std::vector<Snapshot_array> &arrays, double spacing);
+    ~Snapshot_writer();  //closes the file (if not yet closed), only printing an error
+
+    //!Appends the snapshot at voltage \param Va. \param values[k] points to the values of array k, which are multiplied
+    //! by \param scales[k] (e.g. to get physical units). Throws std::runtime_error if it couldn't be written (then later snapshots are skipped).
+    void write(double Va, const std::vector<const double*> &values, const std::vector<double> &scales);
+
+    //!Writes the index and closes the file. Throws std::runtime_error if any part of the file couldn't be written.
+    void close();
+
+private:
+    std::ofstream file;
+    std::string file_name;
+    std::vector<Snapshot_array> arrays;
+    std::vector<double> buffer;   //one record, reused for all voltages
+    std::vector<double> voltages;
+    std::vector<uint64_t> offsets;
+};
+
+
+//!Reads a snapshot file. Only the header and index are read when opening, each snapshot is read when requested.
+class Snapshot_reader
+{
+public:
+    //!Opens \param file_name. Throws std::runtime_error if it's not a valid snapshot file.
+    explicit Snapshot_reader(const std::string &file_name);
+
+    const std::vector<Snapshot_array> &get_arrays() const {return arrays;}
+    const std::vector<double> &get_voltages() const {return voltages;}
+    double get_spacing() const {return spacing;}
+
+    //!Returns the index of the snapshot with voltage nearest to \param Va
+    size_t find(double Va) const;
+
+    //!Reads snapshot \param index into \param values (one vector per array)
+    void read(size_t index, std::vector<std::vector<double> > &values);
+
+private:
+    std::ifstream file;
+    double spacing;
+    std::vector<Snapshot_array> arrays;
+    std::vector<double> voltages;
+    std::vector<uint64_t> offsets;
+};
+
+#endif // SNAPSHOT_FILE_H
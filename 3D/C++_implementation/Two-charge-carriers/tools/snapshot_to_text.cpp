@@ -0,0 +1,104 @@
+/*%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%  Converts snapshots of a binary snapshot file (written by Snapshot_writer) to text.
+%
+%     snapshot_to_text file                   lists the voltages in the file
+%     snapshot_to_text file Va [output_file]  writes the snapshot nearest to Va
+%     snapshot_to_text file all               writes each snapshot to a file named by
+%                                             the voltage (like the text output)
+%
+%     Each line has the coordinates of a mesh point and the values of all arrays
+%     defined on that mesh. Arrays with different dims are written as separate
+%     blocks, each starting with a comment line with the column names.
+%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "snapshot_file.h"
+
+namespace {
+    void write_snapshot(Snapshot_reader &reader, size_t index, std::ostream &out)
+    {
+        std::vector<std::vector<double> > values;
+        reader.read(index, values);
+        const std::vector<Snapshot_array> &arrays = reader.get_arrays();
+
+        std::vector<bool> done(arrays.size(), false);
+        for (size_t k = 0; k < arrays.size(); k++) {
+            if (done[k]) continue;
+
+            //all arrays with the same dims and origin as array k go in one block
+            std::vector<size_t> block;
+            for (size_t m = k; m < arrays.size(); m++) {
+                if (!done[m] && arrays[m].dims == arrays[k].dims && arrays[m].origin == arrays[k].origin) {
+                    block.push_back(m);
+                    done[m] = true;
+                }
+            }
+
+            const std::vector<uint32_t> &dims = arrays[k].dims;
+            out << "#";
+            for (size_t d = 0; d < dims.size(); d++)
+                out << std::setw(15) << ("x" + std::to_string(d));
+            for (size_t b = 0; b < block.size(); b++)
+                out << std::setw(15) << arrays[block[b]].name;
+            out << "\n";
+
+            for (uint64_t i = 0; i < arrays[k].size(); i++) {
+                uint64_t rest = i;
+                out << " ";
+                for (size_t d = 0; d < dims.size(); d++) {  //1st index changes fastest
+                    out << std::setw(15) << std::setprecision(8) << arrays[k].origin[d] + reader.get_spacing()*(rest % dims[d]);
+                    rest /= dims[d];
+                }
+                for (size_t b = 0; b < block.size(); b++)
+                    out << std::setw(15) << std::setprecision(8) << values[block[b]][i];
+                out << "\n";
+            }
+        }
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: snapshot_to_text file [Va|all] [output_file]" << std::endl;
+        return 1;
+    }
+
+    try {
+        Snapshot_reader reader(argv[1]);
+        const std::vector<double> &voltages = reader.get_voltages();
+
+        if (argc == 2) {
+            for (size_t r = 0; r < voltages.size(); r++)
+                std::cout << voltages[r] << "\n";
+        } else if (std::string(argv[2]) == "all") {
+            for (size_t r = 0; r < voltages.size(); r++) {
+                std::ofstream out(std::to_string(voltages[r]) + ".txt");
+                write_snapshot(reader, r, out);
+            }
+        } else {
+            size_t index = reader.find(atof(argv[2]));
+            if (argc > 3) {
+                std::ofstream out(argv[3]);
+                write_snapshot(reader, index, out);
+            } else {
+                write_snapshot(reader, index, std::cout);
+            }
+        }
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "vti_file.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+    const uint64_t chunk_points = 1 << 18;   //# of points converted and written at once by a thread
+
+    bool little_endian()
+    {
+        const uint16_t one = 1;
+        return *reinterpret_cast<const unsigned char*>(&one) == 1;
+    }
+
+    //a chunk of one array: points [begin, end) of array
+    struct Chunk
+    {
+        size_t array;
+        uint64_t begin, end;
+    };
+}
+
+
+Vti_writer::Vti_writer(const std::vector<int> &num_points, double spacing, const std::vector<double> &origin)
+    : num_points(num_points), spacing(spacing), origin(origin)
+{
+    if (num_points.size() != 3 || origin.size() != 3)
+        throw std::runtime_error("Vti_writer needs the # of points and the origin along x, y and z.");
+    total_points = 1;
+    for (int d = 0; d < 3; d++)
+        total_points *= static_cast<uint64_t>(num_points[d]);
+}
+
+
+void Vti_writer::write(const std::string &file_name, const std::vector<Vti_array> &arrays, double Va) const
+{
+    //offset of each array's block (the size as UInt64, then the values) from the start of the appended data
+    std::vector<uint64_t> offsets(arrays.size() + 1, 0);
+    for (size_t a = 0; a < arrays.size(); a++)
+        offsets[a+1] = offsets[a] + sizeof(uint64_t) + total_points*arrays[a].components.size()*sizeof(double);
+
+    std::ostringstream extent;
+    extent << "0 " << num_points[0]-1 << " 0 " << num_points[1]-1 << " 0 " << num_points[2]-1;
+
+    std::ostringstream header;
+    header << std::setprecision(10);
+    header << "<?xml version=\"1.0\"?>\n"
+           << "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\"" << (little_endian() ? "LittleEndian" : "BigEndian")
+           << "\" header_type=\"UInt64\">\n"
+           << "  <ImageData WholeExtent=\"" << extent.str() << "\" Origin=\"" << origin[0] << " " << origin[1] << " " << origin[2] << "\" Spacing=\""
+           << spacing << " " << spacing << " " << spacing << "\">\n"
+           << "    <FieldData>\n"
+           << "      <DataArray type=\"Float64\" Name=\"Va\" NumberOfTuples=\"1\" format=\"ascii\">" << Va << "</DataArray>\n"
+           << "    </FieldData>\n"
+           << "    <Piece Extent=\"" << extent.str() << "\">\n"
+           << "      <PointData>\n";
+    for (size_t a = 0; a < arrays.size(); a++)
+        header << "        <DataArray type=\"Float64\" Name=\"" << arrays[a].name << "\" NumberOfComponents=\""
+               << arrays[a].components.size() << "\" format=\"appended\" offset=\"" << offsets[a] << "\"/>\n";
+    header << "      </PointData>\n"
+           << "    </Piece>\n"
+           << "  </ImageData>\n"
+           << "  <AppendedData encoding=\"raw\">\n   _";
+
+    const std::string header_text = header.str();
+    const std::string footer_text = "\n  </AppendedData>\n</VTKFile>\n";
+    const uint64_t data_start = header_text.size();
+
+    //the header, block sizes and footer are written first, then the threads fill in the values
+    {
+        std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+        if (!file)
+            throw std::runtime_error("Unable to open file " + file_name);
+        file << header_text;
+        for (size_t a = 0; a < arrays.size(); a++) {
+            const uint64_t block_size = offsets[a+1] - offsets[a] - sizeof(uint64_t);
+            file.seekp(data_start + offsets[a]);
+            file.write(reinterpret_cast<const char*>(&block_size), sizeof(block_size));
+        }
+        file.seekp(data_start + offsets.back());
+        file << footer_text;
+        if (!file)
+            throw std::runtime_error("Unable to write file " + file_name);
+    }
+
+    std::vector<Chunk> chunks;
+    for (size_t a = 0; a < arrays.size(); a++)
+        for (uint64_t begin = 0; begin < total_points; begin += chunk_points)
+            chunks.push_back({a, begin, std::min(begin + chunk_points, total_points)});
+
+    const long long num_chunks = static_cast<long long>(chunks.size());
+    bool failed = false;
+
+    #pragma omp parallel
+    {
+        std::fstream file(file_name, std::ios::binary | std::ios::in | std::ios::out);
+        std::vector<double> buffer;
+        bool ok = static_cast<bool>(file);
+
+        #pragma omp for schedule(dynamic)
+        for (long long c = 0; c < num_chunks; c++) {
+            if (!ok)
+                continue;
+            const Chunk &chunk = chunks[c];
+            const Vti_array &array = arrays[chunk.array];
+            const size_t num_components = array.components.size();
+
+            //interleave the components (x0 y0 z0 x1 y1 z1 ...) and scale
+            buffer.resize((chunk.end - chunk.begin)*num_components);
+            for (size_t comp = 0; comp < num_components; comp++) {
+                const double *values = array.components[comp];
+                for (uint64_t i = chunk.begin; i < chunk.end; i++)
+                    buffer[(i - chunk.begin)*num_components + comp] = values ? array.scale*values[i] : 0.0;
+            }
+
+            file.seekp(data_start + offsets[chunk.array] + sizeof(uint64_t) + chunk.begin*num_components*sizeof(double));
+            file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size()*sizeof(double));
+            ok = static_cast<bool>(file);
+        }
+
+        file.close();
+        if (!ok || !file) {
+            #pragma omp critical
+            failed = true;
+        }
+    }
+
+    if (failed)
+        throw std::runtime_error("Unable to write file " + file_name);
+}
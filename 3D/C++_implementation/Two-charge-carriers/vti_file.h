@@ -0,0 +1,41 @@
+#ifndef VTI_FILE_H
+#define VTI_FILE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//!One point data array of a VTI file. components[c] points to component c of the array at all points of the grid,
+//! with the x index changing fastest, then y, then z (the memory order of a column major Eigen matrix/tensor).
+//! A scalar has 1 component, a vector 3; a null pointer is a component that is 0 (e.g. J_y in 2D).
+struct Vti_array
+{
+    std::string name;
+    std::vector<const double*> components;
+    double scale;   //the values are multiplied by this (e.g. to get physical units)
+};
+
+
+//!Writes fields on the whole mesh as VTK XML ImageData (.vti), which can be opened in ParaView or VisIt.
+//! The data is stored as raw appended binary (Float64), so a file is about as large as the fields in memory.
+//! The arrays are converted and written in chunks, and the chunks are written in parallel (with OpenMP, each thread
+//! through its own file stream at the chunk's offset), so that meshes with 10^7 and more points can be written quickly.
+class Vti_writer
+{
+public:
+    //!\param num_points is the # of points along x, y and z (1 along an axis which isn't used, e.g. y in 2D),
+    //! \param spacing is the distance between the points and \param origin the coordinates of the 1st point
+    Vti_writer(const std::vector<int> &num_points, double spacing, const std::vector<double> &origin);
+
+    //!Writes \param arrays to \param file_name, with the applied voltage \param Va as field data.
+    //! Throws std::runtime_error if the file can't be written.
+    void write(const std::string &file_name, const std::vector<Vti_array> &arrays, double Va) const;
+
+private:
+    std::vector<int> num_points;
+    double spacing;
+    std::vector<double> origin;
+    uint64_t total_points;
+};
+
+#endif // VTI_FILE_H